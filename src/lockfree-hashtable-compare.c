@@ -0,0 +1,217 @@
+#include "lockfree-hashtable-compare.h"
+#include <string.h>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define COMPARE_X86
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(__GNUC__)
+#define COMPARE_TARGET(isa) __attribute__((target(isa)))
+#else
+#define COMPARE_TARGET(isa)
+#endif
+
+static bool generic_equal(const void* key1, const void* key2, size_t key_size)
+{
+    return memcmp(key1, key2, key_size) == 0;
+}
+
+// "words" is a constant in every caller, so the loop is unrolled,
+// a function for one key size compares keys of any other size by memcmp
+static inline bool scalar_equal(const void* key1, const void* key2, size_t words)
+{
+    const uint8_t* p1 = key1;
+    const uint8_t* p2 = key2;
+    uint64_t diff = 0;
+    for (size_t i = 0; i < words; ++i) {
+        uint64_t w1, w2;
+        memcpy(&w1, p1 + i * sizeof(uint64_t), sizeof(w1));
+        memcpy(&w2, p2 + i * sizeof(uint64_t), sizeof(w2));
+        diff |= w1 ^ w2;
+    }
+    return diff == 0;
+}
+
+static bool scalar_equal8(const void* key1, const void* key2, size_t key_size)
+{
+    return key_size == 8 ? scalar_equal(key1, key2, 1) : generic_equal(key1, key2, key_size);
+}
+
+static bool scalar_equal16(const void* key1, const void* key2, size_t key_size)
+{
+    return key_size == 16 ? scalar_equal(key1, key2, 2) : generic_equal(key1, key2, key_size);
+}
+
+static bool scalar_equal32(const void* key1, const void* key2, size_t key_size)
+{
+    return key_size == 32 ? scalar_equal(key1, key2, 4) : generic_equal(key1, key2, key_size);
+}
+
+static bool scalar_equal64(const void* key1, const void* key2, size_t key_size)
+{
+    return key_size == 64 ? scalar_equal(key1, key2, 8) : generic_equal(key1, key2, key_size);
+}
+
+static bool scalar_equal128(const void* key1, const void* key2, size_t key_size)
+{
+    return key_size == 128 ? scalar_equal(key1, key2, 16) : generic_equal(key1, key2, key_size);
+}
+
+#ifdef COMPARE_X86
+static inline bool sse2_equal(const void* key1, const void* key2, size_t blocks)
+{
+    const __m128i* p1 = key1;
+    const __m128i* p2 = key2;
+    __m128i eq = _mm_set1_epi8(-1);
+    for (size_t i = 0; i < blocks; ++i) {
+        eq = _mm_and_si128(eq, _mm_cmpeq_epi8(_mm_loadu_si128(p1 + i), _mm_loadu_si128(p2 + i)));
+    }
+    return _mm_movemask_epi8(eq) == 0xffff;
+}
+
+static bool sse2_equal32(const void* key1, const void* key2, size_t key_size)
+{
+    return key_size == 32 ? sse2_equal(key1, key2, 2) : generic_equal(key1, key2, key_size);
+}
+
+static bool sse2_equal64(const void* key1, const void* key2, size_t key_size)
+{
+    return key_size == 64 ? sse2_equal(key1, key2, 4) : generic_equal(key1, key2, key_size);
+}
+
+static bool sse2_equal128(const void* key1, const void* key2, size_t key_size)
+{
+    return key_size == 128 ? sse2_equal(key1, key2, 8) : generic_equal(key1, key2, key_size);
+}
+
+COMPARE_TARGET("avx2")
+static inline bool avx2_equal(const void* key1, const void* key2, size_t blocks)
+{
+    const __m256i* p1 = key1;
+    const __m256i* p2 = key2;
+    __m256i eq = _mm256_set1_epi8(-1);
+    for (size_t i = 0; i < blocks; ++i) {
+        eq = _mm256_and_si256(eq, _mm256_cmpeq_epi8(_mm256_loadu_si256(p1 + i), _mm256_loadu_si256(p2 + i)));
+    }
+    return _mm256_movemask_epi8(eq) == -1;
+}
+
+COMPARE_TARGET("avx2")
+static bool avx2_equal32(const void* key1, const void* key2, size_t key_size)
+{
+    return key_size == 32 ? avx2_equal(key1, key2, 1) : generic_equal(key1, key2, key_size);
+}
+
+COMPARE_TARGET("avx2")
+static bool avx2_equal64(const void* key1, const void* key2, size_t key_size)
+{
+    return key_size == 64 ? avx2_equal(key1, key2, 2) : generic_equal(key1, key2, key_size);
+}
+
+COMPARE_TARGET("avx2")
+static bool avx2_equal128(const void* key1, const void* key2, size_t key_size)
+{
+    return key_size == 128 ? avx2_equal(key1, key2, 4) : generic_equal(key1, key2, key_size);
+}
+
+COMPARE_TARGET("avx512f")
+static bool avx512_equal64(const void* key1, const void* key2, size_t key_size)
+{
+    if (key_size != 64) {
+        return generic_equal(key1, key2, key_size);
+    }
+    return _mm512_cmpneq_epi64_mask(_mm512_loadu_si512(key1), _mm512_loadu_si512(key2)) == 0;
+}
+
+COMPARE_TARGET("avx512f")
+static bool avx512_equal128(const void* key1, const void* key2, size_t key_size)
+{
+    if (key_size != 128) {
+        return generic_equal(key1, key2, key_size);
+    }
+    const uint8_t* p1 = key1;
+    const uint8_t* p2 = key2;
+    const __mmask8 ne1 = _mm512_cmpneq_epi64_mask(_mm512_loadu_si512(p1), _mm512_loadu_si512(p2));
+    const __mmask8 ne2 = _mm512_cmpneq_epi64_mask(_mm512_loadu_si512(p1 + 64), _mm512_loadu_si512(p2 + 64));
+    return (ne1 | ne2) == 0;
+}
+#endif
+
+lockfree_hashtable_isa_t lockfree_hashtable_detect_isa(void)
+{
+#if defined(COMPARE_X86) && defined(__GNUC__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        return LOCKFREE_HASHTABLE_ISA_AVX512;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        return LOCKFREE_HASHTABLE_ISA_AVX2;
+    }
+    return LOCKFREE_HASHTABLE_ISA_SSE2;
+#elif defined(COMPARE_X86) && defined(_MSC_VER)
+    int regs[4];
+    __cpuid(regs, 0);
+    if (regs[0] < 7) {
+        return LOCKFREE_HASHTABLE_ISA_SSE2;
+    }
+    __cpuid(regs, 1);
+    // the OS has to save AVX registers
+    const bool osxsave = (regs[2] & (1 << 27)) != 0;
+    const unsigned long long xcr0 = osxsave ? _xgetbv(0) : 0;
+    __cpuidex(regs, 7, 0);
+    if ((regs[1] & (1 << 16)) && (xcr0 & 0xe6) == 0xe6) {
+        return LOCKFREE_HASHTABLE_ISA_AVX512;
+    }
+    if ((regs[1] & (1 << 5)) && (xcr0 & 0x6) == 0x6) {
+        return LOCKFREE_HASHTABLE_ISA_AVX2;
+    }
+    return LOCKFREE_HASHTABLE_ISA_SSE2;
+#else
+    return LOCKFREE_HASHTABLE_ISA_SCALAR;
+#endif
+}
+
+lockfree_hashtable_key_equal_t lockfree_hashtable_select_key_equal(size_t key_size, lockfree_hashtable_isa_t isa)
+{
+    const lockfree_hashtable_isa_t supported = lockfree_hashtable_detect_isa();
+    if (isa > supported) {
+        isa = supported;
+    }
+
+#ifdef COMPARE_X86
+    if (isa >= LOCKFREE_HASHTABLE_ISA_AVX512) {
+        switch (key_size) {
+            case 64:  return avx512_equal64;
+            case 128: return avx512_equal128;
+        }
+    }
+    if (isa >= LOCKFREE_HASHTABLE_ISA_AVX2) {
+        switch (key_size) {
+            case 32:  return avx2_equal32;
+            case 64:  return avx2_equal64;
+            case 128: return avx2_equal128;
+        }
+    }
+    if (isa >= LOCKFREE_HASHTABLE_ISA_SSE2) {
+        switch (key_size) {
+            case 32:  return sse2_equal32;
+            case 64:  return sse2_equal64;
+            case 128: return sse2_equal128;
+        }
+    }
+#endif
+    if (isa >= LOCKFREE_HASHTABLE_ISA_SCALAR) {
+        switch (key_size) {
+            case 8:   return scalar_equal8;
+            case 16:  return scalar_equal16;
+            case 32:  return scalar_equal32;
+            case 64:  return scalar_equal64;
+            case 128: return scalar_equal128;
+        }
+    }
+    return generic_equal;
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include "lockfree-hashtable.h"
+
+// instruction sets for key comparison, each next one includes the previous ones
+typedef enum {
+    // memcmp
+    LOCKFREE_HASHTABLE_ISA_GENERIC,
+    // 64 bit words
+    LOCKFREE_HASHTABLE_ISA_SCALAR,
+    LOCKFREE_HASHTABLE_ISA_SSE2,
+    LOCKFREE_HASHTABLE_ISA_AVX2,
+    LOCKFREE_HASHTABLE_ISA_AVX512
+} lockfree_hashtable_isa_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// the best instruction set supported by the CPU
+lockfree_hashtable_isa_t lockfree_hashtable_detect_isa(void);
+
+// key comparison function for keys of "key_size" bytes, which uses instructions up to "isa" supported by the CPU,
+// there are special functions for 8, 16, 32, 64 and 128 bytes, other sizes use memcmp,
+// 8 and 16 bytes are compared by 64 bit words on any instruction set, it's faster than vector loads
+lockfree_hashtable_key_equal_t lockfree_hashtable_select_key_equal(size_t key_size, lockfree_hashtable_isa_t isa);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,264 @@
+#include "lockfree-hashtable-values.h"
+#include <string.h>
+#include <errno.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define VALUES_POSIX
+#include <unistd.h>
+#endif
+
+#if defined(__linux__) && !defined(LOCKFREE_HASHTABLE_NO_IO_URING)
+#define VALUES_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <threads.h>
+#endif
+
+bool lockfree_hashtable_values_write(int fd, uint64_t offset, const void* data, size_t size)
+{
+#ifdef VALUES_POSIX
+    const uint8_t* p = data;
+    while (size > 0) {
+        const ssize_t written = pwrite(fd, p, size, (off_t)offset);
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written <= 0) {
+            return false;
+        }
+        p += written;
+        offset += (uint64_t)written;
+        size -= (size_t)written;
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool lockfree_hashtable_values_read(int fd, uint64_t offset, void* data, size_t size)
+{
+#ifdef VALUES_POSIX
+    uint8_t* p = data;
+    while (size > 0) {
+        const ssize_t read = pread(fd, p, size, (off_t)offset);
+        if (read < 0 && errno == EINTR) {
+            continue;
+        }
+        if (read <= 0) {
+            return false;
+        }
+        p += read;
+        offset += (uint64_t)read;
+        size -= (size_t)read;
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+#ifdef VALUES_IO_URING
+
+// reads submitted at once
+#define RING_ENTRIES 64u
+
+// io_uring of a thread, the rings are shared with the kernel
+typedef struct {
+    // -1 if the ring isn't made yet, -2 if io_uring can't be used
+    int fd;
+    unsigned entries;
+    unsigned* sq_tail;
+    unsigned sq_mask;
+    unsigned* sq_array;
+    struct io_uring_sqe* sqes;
+    unsigned* cq_head;
+    unsigned* cq_tail;
+    unsigned cq_mask;
+    struct io_uring_cqe* cqes;
+    void* sq_ring;
+    size_t sq_ring_size;
+    void* cq_ring;
+    size_t cq_ring_size;
+    size_t sqes_size;
+    // vectors of submitted reads, the kernel may use them till the reads complete
+    struct iovec iovecs[RING_ENTRIES];
+} ring_t;
+
+static _Thread_local ring_t ring = {.fd = -1};
+// closes the ring when a thread exits
+static tss_t ring_key;
+static once_flag ring_once = ONCE_FLAG_INIT;
+
+static void ring_close(void)
+{
+    if (ring.sqes != NULL) {
+        munmap(ring.sqes, ring.sqes_size);
+    }
+    if (ring.cq_ring != NULL && ring.cq_ring != ring.sq_ring) {
+        munmap(ring.cq_ring, ring.cq_ring_size);
+    }
+    if (ring.sq_ring != NULL) {
+        munmap(ring.sq_ring, ring.sq_ring_size);
+    }
+    if (ring.fd >= 0) {
+        close(ring.fd);
+    }
+    memset(&ring, 0, sizeof(ring));
+    ring.fd = -2;
+}
+
+// "arg" is the ring of the exiting thread
+static void ring_destroy(void* arg)
+{
+    if (arg != NULL) {
+        ring_close();
+    }
+}
+
+static void ring_create_key(void)
+{
+    tss_create(&ring_key, ring_destroy);
+}
+
+// make the ring of the thread once, return false if io_uring can't be used
+static bool ring_open(void)
+{
+    if (ring.fd != -1) {
+        return ring.fd >= 0;
+    }
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    ring.fd = (int)syscall(__NR_io_uring_setup, RING_ENTRIES, &params);
+    if (ring.fd < 0) {
+        ring_close();
+        return false;
+    }
+    ring.sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring.cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    bool single_mmap = false;
+#ifdef IORING_FEAT_SINGLE_MMAP
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        // both rings are in one mapping
+        single_mmap = true;
+        if (ring.cq_ring_size > ring.sq_ring_size) {
+            ring.sq_ring_size = ring.cq_ring_size;
+        }
+        ring.cq_ring_size = ring.sq_ring_size;
+    }
+#endif
+    ring.sq_ring = mmap(NULL, ring.sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring.fd, IORING_OFF_SQ_RING);
+    if (ring.sq_ring == MAP_FAILED) {
+        ring.sq_ring = NULL;
+        ring_close();
+        return false;
+    }
+    ring.cq_ring = single_mmap ? ring.sq_ring : mmap(NULL, ring.cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring.fd, IORING_OFF_CQ_RING);
+    if (ring.cq_ring == MAP_FAILED) {
+        ring.cq_ring = NULL;
+        ring_close();
+        return false;
+    }
+    ring.sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring.sqes = mmap(NULL, ring.sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring.fd, IORING_OFF_SQES);
+    if (ring.sqes == MAP_FAILED) {
+        ring.sqes = NULL;
+        ring_close();
+        return false;
+    }
+
+    uint8_t* sq = ring.sq_ring;
+    uint8_t* cq = ring.cq_ring;
+    ring.entries = params.sq_entries < RING_ENTRIES ? params.sq_entries : RING_ENTRIES;
+    ring.sq_tail = (unsigned*)(sq + params.sq_off.tail);
+    ring.sq_mask = *(unsigned*)(sq + params.sq_off.ring_mask);
+    ring.sq_array = (unsigned*)(sq + params.sq_off.array);
+    ring.cq_head = (unsigned*)(cq + params.cq_off.head);
+    ring.cq_tail = (unsigned*)(cq + params.cq_off.tail);
+    ring.cq_mask = *(unsigned*)(cq + params.cq_off.ring_mask);
+    ring.cqes = (struct io_uring_cqe*)(cq + params.cq_off.cqes);
+
+    call_once(&ring_once, ring_create_key);
+    tss_set(ring_key, &ring);
+    return true;
+}
+
+static int ring_enter(unsigned submit, unsigned wait)
+{
+    return (int)syscall(__NR_io_uring_enter, ring.fd, submit, wait, IORING_ENTER_GETEVENTS, NULL, 0);
+}
+
+// make up to ring.entries reads, reads which aren't done are left for pread, no read is in flight when this returns,
+// return false if io_uring failed, then the ring has to be closed
+static bool ring_read(int fd, lockfree_hashtable_value_read_t* reads, unsigned count)
+{
+    unsigned tail = *ring.sq_tail;
+    for (unsigned i = 0; i < count; ++i) {
+        ring.iovecs[i].iov_base = reads[i].data;
+        ring.iovecs[i].iov_len = reads[i].size;
+
+        struct io_uring_sqe* sqe = &ring.sqes[tail & ring.sq_mask];
+        memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = IORING_OP_READV;
+        sqe->fd = fd;
+        sqe->off = reads[i].offset;
+        sqe->addr = (uint64_t)(uintptr_t)&ring.iovecs[i];
+        sqe->len = 1;
+        sqe->user_data = i;
+        ring.sq_array[tail & ring.sq_mask] = tail & ring.sq_mask;
+        tail += 1;
+    }
+    __atomic_store_n(ring.sq_tail, tail, __ATOMIC_RELEASE);
+
+    unsigned submitted = 0;
+    unsigned completed = 0;
+    bool failed = false;
+    while (failed ? completed < submitted : completed < count) {
+        // after an error nothing is submitted anymore, reads in flight write into the buffers, so they are waited for till they complete
+        const int result = ring_enter(failed ? 0 : count - submitted, 1);
+        if (result >= 0) {
+            submitted += (unsigned)result;
+        } else if (errno != EINTR) {
+            failed = true;
+        }
+
+        unsigned head = *ring.cq_head;
+        const unsigned cq_tail = __atomic_load_n(ring.cq_tail, __ATOMIC_ACQUIRE);
+        for (; head != cq_tail; ++head) {
+            const struct io_uring_cqe* cqe = &ring.cqes[head & ring.cq_mask];
+            lockfree_hashtable_value_read_t* read = &reads[cqe->user_data];
+            // a short read is made again by pread
+            read->done = cqe->res >= 0 && (size_t)cqe->res == read->size;
+            completed += 1;
+        }
+        __atomic_store_n(ring.cq_head, head, __ATOMIC_RELEASE);
+    }
+    return !failed;
+}
+
+#endif
+
+void lockfree_hashtable_values_read_batch(int fd, lockfree_hashtable_value_read_t* reads, size_t count)
+{
+    for (size_t i = 0; i < count; ++i) {
+        reads[i].done = false;
+    }
+#ifdef VALUES_IO_URING
+    if (ring_open()) {
+        for (size_t first = 0; first < count; first += ring.entries) {
+            const unsigned chunk = count - first < ring.entries ? (unsigned)(count - first) : ring.entries;
+            if (!ring_read(fd, reads + first, chunk)) {
+                ring_close();
+                break;
+            }
+        }
+    }
+#endif
+    for (size_t i = 0; i < count; ++i) {
+        if (!reads[i].done) {
+            reads[i].done = lockfree_hashtable_values_read(fd, reads[i].offset, reads[i].data, reads[i].size);
+        }
+    }
+}
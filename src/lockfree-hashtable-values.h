@@ -0,0 +1,27 @@
+#pragma once
+#include "lockfree-hashtable.h"
+
+// one read of a value from the value file
+typedef struct {
+    uint64_t offset;
+    void* data;
+    size_t size;
+    // set by lockfree_hashtable_values_read_batch if the whole value was read
+    bool done;
+} lockfree_hashtable_value_read_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// write or read "size" bytes at "offset" of the value file, return false on an error or on a short file
+bool lockfree_hashtable_values_write(int fd, uint64_t offset, const void* data, size_t size);
+bool lockfree_hashtable_values_read(int fd, uint64_t offset, void* data, size_t size);
+
+// make all reads at once by io_uring of the calling thread, reads which io_uring can't do are made by pread one by one,
+// io_uring is off if it isn't supported by the kernel or LOCKFREE_HASHTABLE_NO_IO_URING is defined
+void lockfree_hashtable_values_read_batch(int fd, lockfree_hashtable_value_read_t* reads, size_t count);
+
+#ifdef __cplusplus
+}
+#endif
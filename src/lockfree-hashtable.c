@@ -1,17 +1,44 @@
 #include "lockfree-hashtable.h"
+#include "lockfree-hashtable-compare.h"
+#include "lockfree-hashtable-values.h"
 #include <limits.h>
+#include <stddef.h>
 #include <string.h>
 #include <stdatomic.h>
+#include <threads.h>
+#include <time.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
 
 typedef _Atomic(uint32_t) atomic_uint32_t;
 typedef _Atomic(uint64_t) atomic_uint64_t;
 
-#define NULL_ITEM UINT32_MAX
+// no record, kept in an entry as all ones in the bits of the record index
+#define NULL_ITEM UINT64_MAX
 
 static size_t roundup(size_t x, size_t y) {
     return ((x + y - 1) / y) * y;
 }
 
+// index of the lowest set bit, "x" must not be 0
+static unsigned count_trailing_zeros(uint64_t x)
+{
+#if defined(__GNUC__)
+    return (unsigned)__builtin_ctzll(x);
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+    unsigned long index;
+    _BitScanForward64(&index, x);
+    return (unsigned)index;
+#else
+    unsigned index = 0;
+    for (; (x & 1u) == 0; x >>= 1) {
+        index += 1;
+    }
+    return index;
+#endif
+}
+
 static uint32_t calc_hash(const void *data, size_t size)
 {
     const uint8_t *p = data;
@@ -30,255 +57,2344 @@ static uint32_t calc_hash(const void *data, size_t size)
     return h;
 }
 
-size_t lockfree_hashtable_calc_mem_size(const lockfree_hashtable_config_t* config)
+static uint64_t rotl64(uint64_t x, unsigned r)
 {
-    const size_t table_size = config->table_size * sizeof(atomic_uint64_t);
-    const size_t keys       = roundup(config->table_size * config->key_size, sizeof(uint64_t));
-    const size_t values     = roundup(config->table_size * config->val_size, sizeof(uint64_t));
-    const size_t pool_size  = config->table_size / 64u + (config->table_size % 64u ? 1 : 0);
-    const size_t pool       = pool_size * sizeof(atomic_uint64_t);
-    return table_size + keys + values + pool;
+    return (x << r) | (x >> (64u - r));
 }
 
-void lockfree_hashtable_init(lockfree_hashtable_t* table, const lockfree_hashtable_config_t* config, void* memory)
+static uint64_t fmix64(uint64_t k)
 {
-    table->config = config;
+    k ^= k >> 33u;
+    k *= UINT64_C(0xff51afd7ed558ccd);
+    k ^= k >> 33u;
+    k *= UINT64_C(0xc4ceb9fe1a85ec53);
+    k ^= k >> 33u;
+    return k;
+}
 
-    const size_t table_size = config->table_size * sizeof(atomic_uint64_t);
-    const size_t key_size   = roundup(config->table_size * config->key_size, sizeof(uint64_t));
-    const size_t val_size   = roundup(config->table_size * config->val_size, sizeof(uint64_t));
-    const size_t pool_size  = config->table_size / 64u + (config->table_size % 64u ? 1 : 0);
+// MurmurHash3 x64 128 bit
+static void calc_wide_hash(const void *data, size_t size, uint64_t hash[2])
+{
+    const uint64_t c1 = UINT64_C(0x87c37b91114253d5);
+    const uint64_t c2 = UINT64_C(0x4cf5ad432745937f);
+    const uint8_t *p = data;
+    uint64_t h1 = 0;
+    uint64_t h2 = 0;
 
-    uint8_t *ptr = memory;
-    size_t offset = 0;
+    for (size_t i = 0; i < size / 16u; ++i, p += 16u) {
+        uint64_t k1, k2;
+        memcpy(&k1, p, sizeof(k1));
+        memcpy(&k2, p + sizeof(k1), sizeof(k2));
 
-    table->entries = ptr + offset;
-    offset += table_size;
+        k1 *= c1; k1 = rotl64(k1, 31u); k1 *= c2; h1 ^= k1;
+        h1 = rotl64(h1, 27u); h1 += h2; h1 = h1 * 5u + 0x52dce729u;
+        k2 *= c2; k2 = rotl64(k2, 33u); k2 *= c1; h2 ^= k2;
+        h2 = rotl64(h2, 31u); h2 += h1; h2 = h2 * 5u + 0x38495ab5u;
+    }
 
-    table->keys = ptr + offset;
-    offset += key_size;
+    uint64_t k1 = 0;
+    uint64_t k2 = 0;
+    const size_t tail = size % 16u;
+    for (size_t i = tail; i > 8u; --i) {
+        k2 ^= (uint64_t)p[i - 1] << ((i - 9u) * 8u);
+    }
+    for (size_t i = tail < 8u ? tail : 8u; i > 0u; --i) {
+        k1 ^= (uint64_t)p[i - 1] << ((i - 1u) * 8u);
+    }
+    if (tail > 8u) {
+        k2 *= c2; k2 = rotl64(k2, 33u); k2 *= c1; h2 ^= k2;
+    }
+    if (tail > 0u) {
+        k1 *= c1; k1 = rotl64(k1, 31u); k1 *= c2; h1 ^= k1;
+    }
 
-    table->vals = ptr + offset;
-    offset += val_size;
+    h1 ^= size;
+    h2 ^= size;
+    h1 += h2;
+    h2 += h1;
+    h1 = fmix64(h1);
+    h2 = fmix64(h2);
+    h1 += h2;
+    h2 += h1;
 
-    table->pool = ptr + offset;
+    hash[0] = h1;
+    hash[1] = h2;
+}
 
-    memset(table->entries, 0, table_size);
-    memset(table->pool, 0, pool_size * sizeof(atomic_uint64_t));
+// size of a key inside a record
+static size_t stored_key_size(unsigned flags, size_t key_size)
+{
+    return (flags & LOCKFREE_HASHTABLE_HASHED_KEYS) ? 2 * sizeof(uint64_t) : key_size;
 }
 
-static uint32_t allocate_item(lockfree_hashtable_t* table)
+// hash of a key in the form it is kept in a record, 32 bit hash is not enough to spread keys over a table with wide index
+static uint64_t calc_stored_key_hash(unsigned flags, const void* key, size_t key_size)
 {
-    const lockfree_hashtable_config_t* config = table->config;
-    const size_t pool_size  = config->table_size / 64u + (config->table_size % 64u ? 1 : 0);
-    atomic_uint64_t* pool = table->pool;
+    if (flags & LOCKFREE_HASHTABLE_HASHED_KEYS) {
+        uint64_t hash;
+        memcpy(&hash, key, sizeof(hash));
+        return hash;
+    }
+    if (flags & LOCKFREE_HASHTABLE_WIDE_INDEX) {
+        uint64_t hash[2];
+        calc_wide_hash(key, key_size, hash);
+        return hash[0];
+    }
+    return calc_hash(key, key_size);
+}
 
-    // scan and search a free bit in the pool
-    for (size_t i = 0; i < pool_size; ++i) {
-        const uint64_t chunk = atomic_load_explicit(&pool[i], memory_order_relaxed);
-        if (chunk != UINT64_MAX) {
-            for (size_t index = 0u; index < 64u; ++index) {
-                if (index + i * 64u < config->table_size) {
-                    const uint64_t bit = (UINT64_C(1) << index);
-                    if ((chunk & bit) == UINT64_C(0)) {
-                        // try to set bit
-                        if (!(atomic_fetch_or_explicit(&pool[i], bit, memory_order_acquire) & bit)) {
-                            return index + i * 64u;
-                        }
-                    }
-                } else {
-                    return NULL_ITEM;
-                }
-            }
-        }
+// turn a key into the form it is kept in a record, "stored" is used as a storage for the hashed key,
+// return hash of the key
+static uint64_t prepare_key(unsigned flags, size_t key_size, const void** key, uint64_t stored[2])
+{
+    if (flags & LOCKFREE_HASHTABLE_HASHED_KEYS) {
+        calc_wide_hash(*key, key_size, stored);
+        *key = stored;
+        return stored[0];
     }
-    return NULL_ITEM;
+    return calc_stored_key_hash(flags, *key, key_size);
 }
 
-static void delete_item(lockfree_hashtable_t* table, uint32_t item)
+// bits of a record index in an entry, the rest bits keep the version
+static unsigned item_bits(const lockfree_hashtable_config_t* config)
 {
-    if (item == NULL_ITEM) {
-        return;
+    return (config->flags & LOCKFREE_HASHTABLE_WIDE_INDEX) ? 40u : 32u;
+}
+
+static uint64_t entry_item(const lockfree_hashtable_config_t* config, uint64_t entry)
+{
+    const uint64_t mask = (UINT64_C(1) << item_bits(config)) - 1u;
+    const uint64_t item = entry & mask;
+    return item == mask ? NULL_ITEM : item;
+}
+
+static uint64_t entry_version(const lockfree_hashtable_config_t* config, uint64_t entry)
+{
+    return entry >> item_bits(config);
+}
+
+static uint64_t make_entry(const lockfree_hashtable_config_t* config, uint64_t version, uint64_t item)
+{
+    const unsigned bits = item_bits(config);
+    // version 0 means a free entry, so it is skipped when the version wraps around
+    version &= UINT64_MAX >> bits;
+    if (version == 0) {
+        version = 1;
     }
-    atomic_uint64_t* pool = table->pool;
-    const uint64_t bit = (UINT64_C(1) << (item % 64));
-    atomic_fetch_and_explicit(&pool[item / 64], ~bit, memory_order_release);
+    return (version << bits) | (item & ((UINT64_C(1) << bits) - 1u));
 }
 
-static void* get_item_key(lockfree_hashtable_t* table, uint32_t item)
+// header of the change feed, slots go after it
+typedef struct {
+    // sequence number of the next event
+    atomic_uint64_t head;
+    // the biggest sequence number + 1 of events which were lost because their slot was busy
+    atomic_uint64_t lost;
+} changefeed_t;
+
+// slot of the change feed, the stored key and the value go after it
+typedef struct {
+    // (sequence number + 1) << 2 | CHANGEFEED_* state
+    atomic_uint64_t stamp;
+    uint64_t type;
+} changefeed_slot_t;
+
+#define CHANGEFEED_WRITING UINT64_C(1)
+#define CHANGEFEED_READY   UINT64_C(2)
+#define CHANGEFEED_STATE   UINT64_C(3)
+
+// event which is written instead of a failed CAS, readers skip it
+#define CHANGEFEED_NOTHING 0
+
+static size_t changefeed_slot_size(const lockfree_hashtable_config_t* config)
 {
-    const lockfree_hashtable_config_t* config = table->config;
-    uint8_t* keys = table->keys;
-    return keys + item * config->key_size;
+    const size_t key_size = stored_key_size(config->flags, config->key_size);
+    return roundup(sizeof(changefeed_slot_t) + key_size + config->val_size, sizeof(uint64_t));
 }
 
-static void* get_item_val(lockfree_hashtable_t* table, uint32_t item)
+// the filter of absent keys is a counting Bloom filter split into blocks of one cache line,
+// a key sets FILTER_HASHES 4 bit counters inside one block, so a check reads one cache line
+#define FILTER_BLOCK_SIZE   64u
+#define FILTER_BLOCK_WORDS  (FILTER_BLOCK_SIZE / sizeof(uint64_t))
+#define FILTER_COUNTER_BITS 4u
+#define FILTER_COUNTER_MAX  UINT64_C(15)
+#define FILTER_HASHES       4u
+// bits of a counter position inside a block
+#define FILTER_POSITION_BITS 7u
+
+// the ordered index is a skiplist, every record is a node with a link on the lowest level, the head is the node after the last record,
+// links of upper levels are kept in one array per level: every 4th record has a link on level 1, every 16th on level 2 and so on,
+// keys don't depend on record indexes, so nodes of every level are spread over the key order as with random heights
+#define INDEX_LEVELS 12u
+#define INDEX_LEVEL_BITS 2u
+// a link keeps the next record (low bits, as in an entry), its generation, the generation of the node which owns the link
+// and the mark of a removed node (the highest bit), so a link of a reused node never equals a link it had before and a CAS
+// of a thread which still holds the old node fails
+#define INDEX_MARK UINT64_C(0x8000000000000000)
+
+typedef struct {
+    // changed every time the record is allocated, so a link to a reused record can be detected
+    atomic_uint64_t generation;
+    atomic_uint64_t link;
+} index_node_t;
+
+// number of links on an upper level: records with the index divisible by 4^level and the head after them
+static size_t index_level_size(size_t table_size, unsigned level)
 {
-    const lockfree_hashtable_config_t* config = table->config;
-    uint8_t* vals = table->vals;
-    return vals + item * config->val_size;
+    const unsigned shift = level * INDEX_LEVEL_BITS;
+    return ((table_size + (((size_t)1 << shift) - 1u)) >> shift) + 1u;
 }
 
-bool lockfree_hashtable_insert(lockfree_hashtable_t* table, const void* key, const void* val)
+static size_t index_mem_size(size_t table_size)
 {
-    const lockfree_hashtable_config_t* config = table->config;
-    atomic_uint64_t* entries = table->entries;
-    atomic_uint64_t* pool = table->pool;
+    size_t size = (table_size + 1) * sizeof(index_node_t);
+    for (unsigned level = 1; level < INDEX_LEVELS; ++level) {
+        size += index_level_size(table_size, level) * sizeof(atomic_uint64_t);
+    }
+    return size;
+}
 
-    // allocate a new item
-    const uint32_t item = allocate_item(table);
-    if (item == NULL_ITEM) {
-        return false;
+static index_node_t* get_index_node(lockfree_hashtable_t* table, uint64_t item)
+{
+    index_node_t* nodes = table->index;
+    return nodes + item;
+}
+
+// link of a node on a level, the node has to have the level
+static atomic_uint64_t* get_index_link(lockfree_hashtable_t* table, uint64_t item, unsigned level)
+{
+    const size_t table_size = table->config->table_size;
+    if (level == 0) {
+        return &get_index_node(table, item)->link;
     }
+    atomic_uint64_t* links = (atomic_uint64_t*)((index_node_t*)table->index + table_size + 1);
+    for (unsigned lower = 1; lower < level; ++lower) {
+        links += index_level_size(table_size, lower);
+    }
+    return links + (item == table_size ? index_level_size(table_size, level) - 1u : item >> (level * INDEX_LEVEL_BITS));
+}
 
-    // fill data from parameters
-    memcpy(get_item_key(table, item), key, config->key_size);
-    memcpy(get_item_val(table, item), val, config->val_size);
+// generation of the next record goes after the record index, the rest of the bits below the mark keep the owner's generation
+static unsigned index_generation_bits(const lockfree_hashtable_config_t* config)
+{
+    return (64u - item_bits(config)) / 2u;
+}
 
-    const uint32_t hash = calc_hash(key, config->key_size);
+static uint64_t index_generation_mask(const lockfree_hashtable_config_t* config)
+{
+    return (UINT64_C(1) << index_generation_bits(config)) - 1u;
+}
 
-    for (size_t i = 0, index = hash % config->table_size; i < config->table_size; ++i, index = (index + 1) % config->table_size) {
-        // read table entry
-        uint64_t old_entry = atomic_load(&entries[index]);
-        do {
-            const uint32_t old_item = old_entry;
-            const uint32_t old_version = old_entry >> 32u;
+static uint64_t index_link(const lockfree_hashtable_config_t* config, uint64_t item, uint64_t generation)
+{
+    return (generation << item_bits(config)) | (item & ((UINT64_C(1) << item_bits(config)) - 1u));
+}
 
-            uint32_t new_item = item;
-            // increment a version
-            uint32_t new_version = old_version + 1;
-            // calc new entry
-            uint64_t new_entry = ((uint64_t)new_version << 32u) | (uint64_t)new_item;
+// link of the node with the "generation" to the record of "target", the mark is dropped
+static uint64_t index_owned_link(const lockfree_hashtable_config_t* config, uint64_t target, uint64_t generation)
+{
+    const unsigned shift = item_bits(config) + index_generation_bits(config);
+    return ((generation << shift) & ~INDEX_MARK) | (target & ((UINT64_C(1) << shift) - 1u));
+}
 
-            const bool can_insert = (old_version == 0) // version == 0 means free entry
-                // if entry is deleted
-                || (old_item == NULL_ITEM)
-                // if keys are equal
-                || (memcmp(key, get_item_key(table, old_item), config->key_size) == 0)
-            ;
+// check that "link" is owned by the node with the "generation"
+static bool index_owned_by(const lockfree_hashtable_config_t* config, uint64_t link, uint64_t generation)
+{
+    const unsigned shift = item_bits(config) + index_generation_bits(config);
+    return ((link ^ (generation << shift)) & ~INDEX_MARK) >> shift == 0;
+}
 
-            if (can_insert) {
-                // try to make a CAS
-                if (atomic_compare_exchange_weak(&entries[index], &old_entry, new_entry)) {
-                    if (old_version > 0) {
-                        delete_item(table, old_item);
-                    }
-                    return true;
-                }
-                // if CAS was failed then try again
-            } else {
-                // check that entry wasn't changed
-                new_entry = atomic_load(&entries[index]);
-                if (new_entry == old_entry) {
-                    // if entry is same, we've found a collision, so go to the next entry
-                    break;
-                }
-                old_entry = new_entry;
-            }
-        } while(true);
+// the same owner as "link" with the record of "target"
+static uint64_t index_relink(const lockfree_hashtable_config_t* config, uint64_t link, uint64_t target)
+{
+    const unsigned shift = item_bits(config) + index_generation_bits(config);
+    return (link & ~INDEX_MARK & ~((UINT64_C(1) << shift) - 1u)) | (target & ((UINT64_C(1) << shift) - 1u));
+}
+
+static uint64_t index_link_item(const lockfree_hashtable_config_t* config, uint64_t link)
+{
+    return entry_item(config, link);
+}
+
+static uint64_t index_link_generation(const lockfree_hashtable_config_t* config, uint64_t link)
+{
+    return (link >> item_bits(config)) & index_generation_mask(config);
+}
+
+// the tracker of hot keys is a Count-Min sketch of HOTKEYS_DEPTH rows of counters and HOTKEYS_TOP slots of the hottest keys
+#define HOTKEYS_DEPTH 4u
+#define HOTKEYS_WIDTH 2048u
+#define HOTKEYS_TOP   32u
+
+typedef struct {
+    // hash of the key, 0 if the slot is free
+    atomic_uint64_t hash;
+    atomic_uint64_t count;
+    atomic_uint64_t retries;
+} hotkeys_slot_t;
+
+typedef struct {
+    hotkeys_slot_t top[HOTKEYS_TOP];
+    atomic_uint64_t sketch[HOTKEYS_DEPTH][HOTKEYS_WIDTH];
+} hotkeys_t;
+
+// operations left till the next sampled one, shared by all tables of the thread
+static _Thread_local size_t hotkeys_countdown;
+// xorshift state for random gaps between sampled operations, so periodic access patterns don't hide keys
+static _Thread_local uint64_t hotkeys_random;
+
+// header of the epochs of a clearable table, the epochs of records and then the epochs of entries go after it
+typedef struct {
+    // the current epoch, incremented by every clear
+    atomic_uint64_t epoch;
+    // next entry to check for a stale record, the table size when all entries are checked
+    atomic_uint64_t sweep;
+} clear_t;
+
+// entries swept by every insert after a clear
+#define SWEEP_STEP 2u
+
+// header of the values of a tiered table, slots of the value cache go after it
+typedef struct {
+    // end of the value file, values are appended to it
+    atomic_uint64_t end;
+} tiered_t;
+
+// a cached value, the stamp is 0 for an empty slot, (offset + 1) * 2 for the value at "offset" of the file, odd while the value is written
+typedef struct {
+    atomic_uint64_t stamp;
+} value_cache_slot_t;
+
+static size_t value_cache_slot_size(const lockfree_hashtable_config_t* config)
+{
+    return roundup(sizeof(value_cache_slot_t) + config->val_size, sizeof(uint64_t));
+}
+
+// free records cached by threads of a LOCKFREE_HASHTABLE_MAGAZINES table are kept in magazines inside the table memory,
+// a thread uses the magazine of its number and threads with the same number share it
+#define MAGAZINE_COUNT 64u
+// records freed from other pool words which a magazine keeps, so a magazine takes two cache lines
+#define MAGAZINE_FREED 13u
+
+typedef struct {
+    // 1 while a thread takes or puts a record
+    atomic_uint32_t busy;
+    uint32_t count;
+    // pool word of the reserved records
+    uint64_t word;
+    // bits of free reserved records of the word, their bits in the pool stay set
+    uint64_t free;
+    // records freed from other words, "count" of them
+    uint64_t freed[MAGAZINE_FREED];
+} magazine_t;
+
+// offsets of parts of the table memory from its beginning, the parts go one after another in this order
+typedef struct {
+    uint64_t entries;
+    uint64_t keys;
+    uint64_t vals;
+    uint64_t pool;
+    // 0 if there is no change feed
+    uint64_t changefeed;
+    // 0 if there is no filter
+    uint64_t filter;
+    // 0 if there is no ordered index
+    uint64_t index;
+    // 0 if there is no tracker of hot keys
+    uint64_t hotkeys;
+    // 0 if the table isn't clearable
+    uint64_t clear;
+    // 0 if values are kept in memory
+    uint64_t tiered;
+    // 0 if the table has no magazines
+    uint64_t magazines;
+    // size of the whole memory
+    uint64_t size;
+} layout_t;
+
+// the table memory starts with this header, so the table can be attached from another process or another address
+typedef struct {
+    atomic_uint64_t magic;
+    lockfree_hashtable_config_t config;
+    layout_t layout;
+} table_header_t;
+
+#define TABLE_MAGIC UINT64_C(0x315442484654464c) // "LFTFHBT1"
+
+// parts are aligned by cache line
+#define LAYOUT_ALIGN 64u
+
+static layout_t calc_layout(const lockfree_hashtable_config_t* config)
+{
+    const size_t pool_size = config->table_size / 64u + (config->table_size % 64u ? 1 : 0);
+
+    layout_t layout;
+    size_t offset = roundup(sizeof(table_header_t), LAYOUT_ALIGN);
+
+    layout.entries = offset;
+    offset += roundup(config->table_size * sizeof(atomic_uint64_t), LAYOUT_ALIGN);
+
+    layout.keys = offset;
+    offset += roundup(config->table_size * stored_key_size(config->flags, config->key_size), LAYOUT_ALIGN);
+
+    // records of a tiered table keep offsets of values in the value file
+    layout.vals = offset;
+    offset += roundup(config->table_size * ((config->flags & LOCKFREE_HASHTABLE_TIERED_VALUES) ? sizeof(uint64_t) : config->val_size), LAYOUT_ALIGN);
+
+    layout.pool = offset;
+    offset += roundup(pool_size * sizeof(atomic_uint64_t), LAYOUT_ALIGN);
+
+    layout.changefeed = 0;
+    if (config->changefeed_size) {
+        layout.changefeed = offset;
+        offset += roundup(sizeof(changefeed_t) + config->changefeed_size * changefeed_slot_size(config), LAYOUT_ALIGN);
     }
-    return false;
+
+    layout.filter = 0;
+    if (config->filter_size) {
+        layout.filter = offset;
+        offset += roundup(config->filter_size, FILTER_BLOCK_SIZE);
+    }
+
+    layout.index = 0;
+    if ((config->flags & LOCKFREE_HASHTABLE_ORDERED_INDEX) && !(config->flags & LOCKFREE_HASHTABLE_HASHED_KEYS)) {
+        layout.index = offset;
+        offset += roundup(index_mem_size(config->table_size), LAYOUT_ALIGN);
+    }
+
+    layout.hotkeys = 0;
+    if (config->hotkeys_sampling) {
+        layout.hotkeys = offset;
+        offset += roundup(sizeof(hotkeys_t), LAYOUT_ALIGN);
+    }
+
+    layout.clear = 0;
+    if (config->flags & LOCKFREE_HASHTABLE_CLEARABLE) {
+        layout.clear = offset;
+        offset += roundup(sizeof(clear_t) + 2 * config->table_size * sizeof(atomic_uint32_t), LAYOUT_ALIGN);
+    }
+
+    layout.tiered = 0;
+    if (config->flags & LOCKFREE_HASHTABLE_TIERED_VALUES) {
+        layout.tiered = offset;
+        offset += roundup(sizeof(tiered_t) + config->value_cache_size * value_cache_slot_size(config), LAYOUT_ALIGN);
+    }
+
+    layout.magazines = 0;
+    if (config->flags & LOCKFREE_HASHTABLE_MAGAZINES) {
+        layout.magazines = offset;
+        offset += roundup(MAGAZINE_COUNT * sizeof(magazine_t), LAYOUT_ALIGN);
+    }
+
+    layout.size = offset;
+    return layout;
 }
 
-bool lockfree_hashtable_find(lockfree_hashtable_t* table, const void* key, void* val)
+// fill pointers of the table from the header in its memory
+static void set_table_parts(lockfree_hashtable_t* table, void* memory)
+{
+    table_header_t* header = memory;
+    const layout_t* layout = &header->layout;
+    uint8_t *ptr = memory;
+
+    table->config = &header->config;
+    table->key_equal = lockfree_hashtable_select_key_equal(stored_key_size(header->config.flags, header->config.key_size), lockfree_hashtable_detect_isa());
+    table->entries = ptr + layout->entries;
+    table->keys = ptr + layout->keys;
+    table->vals = ptr + layout->vals;
+    table->pool = ptr + layout->pool;
+    table->changefeed = layout->changefeed ? ptr + layout->changefeed : NULL;
+    table->filter = layout->filter ? ptr + layout->filter : NULL;
+    table->index = layout->index ? ptr + layout->index : NULL;
+    table->hotkeys = layout->hotkeys ? ptr + layout->hotkeys : NULL;
+    table->clear = layout->clear ? ptr + layout->clear : NULL;
+    table->tiered = layout->tiered ? ptr + layout->tiered : NULL;
+    table->magazines = layout->magazines ? ptr + layout->magazines : NULL;
+    table->values_fd = -1;
+}
+
+size_t lockfree_hashtable_calc_mem_size(const lockfree_hashtable_config_t* config)
+{
+    // all ones in the bits of a record index mean no record
+    if (config->table_size >= (UINT64_C(1) << item_bits(config)) - 1u) {
+        return 0;
+    }
+    return calc_layout(config).size;
+}
+
+void lockfree_hashtable_init(lockfree_hashtable_t* table, const lockfree_hashtable_config_t* config, void* memory)
+{
+    table_header_t* header = memory;
+    header->config = *config;
+    header->layout = calc_layout(config);
+
+    set_table_parts(table, memory);
+    // records don't need to be cleared, all parts after them start from zeros
+    memset(table->entries, 0, header->layout.keys - header->layout.entries);
+    memset(table->pool, 0, header->layout.size - header->layout.pool);
+    if (table->clear) {
+        // nothing to sweep in the first epoch
+        clear_t* clear = table->clear;
+        atomic_store_explicit(&clear->sweep, config->table_size, memory_order_relaxed);
+    }
+    if (table->index) {
+        for (unsigned level = 0; level < INDEX_LEVELS; ++level) {
+            atomic_store_explicit(get_index_link(table, config->table_size, level), index_link(config, NULL_ITEM, 0), memory_order_relaxed);
+        }
+    }
+
+    // the table can be attached only after it is ready
+    atomic_store_explicit(&header->magic, TABLE_MAGIC, memory_order_release);
+}
+
+bool lockfree_hashtable_attach(lockfree_hashtable_t* table, void* memory)
+{
+    table_header_t* header = memory;
+    if (atomic_load_explicit(&header->magic, memory_order_acquire) != TABLE_MAGIC) {
+        return false;
+    }
+    set_table_parts(table, memory);
+    return true;
+}
+
+// hash of a stored key for the filter, independent from the hash used for the probe position
+static uint64_t calc_filter_hash(lockfree_hashtable_t* table, const void* key)
 {
     const lockfree_hashtable_config_t* config = table->config;
-    atomic_uint64_t* entries = table->entries;
-    atomic_uint64_t* pool = table->pool;
+    uint64_t hash[2];
+    if (config->flags & LOCKFREE_HASHTABLE_HASHED_KEYS) {
+        memcpy(hash, key, sizeof(hash));
+    } else {
+        calc_wide_hash(key, config->key_size, hash);
+    }
+    return hash[1];
+}
 
-    const uint32_t hash = calc_hash(key, config->key_size);
-    for (size_t i = 0, index = hash % config->table_size; i < config->table_size; ++i, index = (index + 1) % config->table_size) {
-        // read table entry
-        uint64_t entry = atomic_load(&entries[index]);
-        do {
-            const uint32_t item = entry;
-            const uint32_t version = entry >> 32u;
+static atomic_uint64_t* get_filter_block(lockfree_hashtable_t* table, uint64_t hash)
+{
+    const lockfree_hashtable_config_t* config = table->config;
+    const size_t blocks = roundup(config->filter_size, FILTER_BLOCK_SIZE) / FILTER_BLOCK_SIZE;
+    atomic_uint64_t* filter = table->filter;
+    return filter + ((hash >> (FILTER_HASHES * FILTER_POSITION_BITS)) % blocks) * FILTER_BLOCK_WORDS;
+}
 
-            // version == 0 means free entry
-            if (version == 0) {
-                return false;
-            }
-            // if entry is deleted
-            if (item == NULL_ITEM) {
+// add "delta" (1 or -1) to counters of a key, full counters stay full forever, so they never give a false negative
+static void filter_update(lockfree_hashtable_t* table, uint64_t hash, int delta)
+{
+    if (table->filter == NULL) {
+        return;
+    }
+    atomic_uint64_t* block = get_filter_block(table, hash);
+    for (unsigned i = 0; i < FILTER_HASHES; ++i) {
+        const unsigned position = (hash >> (i * FILTER_POSITION_BITS)) & ((1u << FILTER_POSITION_BITS) - 1u);
+        atomic_uint64_t* word = &block[position / (64u / FILTER_COUNTER_BITS)];
+        const unsigned shift = (position % (64u / FILTER_COUNTER_BITS)) * FILTER_COUNTER_BITS;
+
+        uint64_t old_value = atomic_load_explicit(word, memory_order_relaxed);
+        do {
+            const uint64_t counter = (old_value >> shift) & FILTER_COUNTER_MAX;
+            if (counter == FILTER_COUNTER_MAX || (counter == 0 && delta < 0)) {
                 break;
             }
-            // compare keys
-            if (memcmp(key, get_item_key(table, item), config->key_size) == 0) {
-                // copy value if "val" is not NULL
-                if (val != NULL) {
-                    memcpy(val, get_item_val(table, item), config->val_size);
-                }
-                // check that entry wasn't changed
-                const uint64_t new_entry = atomic_load(&entries[index]);
-                if (new_entry == entry) {
-                    // if entry is same then return success
-                    return true;
-                }
-                // we've found that somebody changed our entry, try again
-                entry = new_entry;
-            } else {
-                // if keys are not equal, maybe somebody changed our entry, check it
-                const uint64_t new_entry = atomic_load(&entries[index]);
-                if (new_entry == entry) {
-                    // if entry is same, so go to the next entry
-                    break;
-                }
-                entry = new_entry;
+            const uint64_t new_value = delta > 0 ? old_value + (UINT64_C(1) << shift) : old_value - (UINT64_C(1) << shift);
+            if (atomic_compare_exchange_weak(word, &old_value, new_value)) {
+                break;
             }
         } while(true);
     }
-    return false;
 }
 
-bool lockfree_hashtable_erase(lockfree_hashtable_t* table, const void* key)
+// 64 bit hash of a stored key which identifies it in the tracker of hot keys, never 0
+static uint64_t calc_hotkey_hash(lockfree_hashtable_t* table, const void* key)
 {
     const lockfree_hashtable_config_t* config = table->config;
-    atomic_uint64_t* entries = table->entries;
-    atomic_uint64_t* pool = table->pool;
-
-    const uint32_t hash = calc_hash(key, config->key_size);
+    uint64_t hash[2];
+    if (config->flags & LOCKFREE_HASHTABLE_HASHED_KEYS) {
+        memcpy(hash, key, sizeof(hash));
+    } else {
+        calc_wide_hash(key, config->key_size, hash);
+    }
+    return hash[0] ? hash[0] : 1;
+}
 
-    for (size_t i = 0, index = hash % config->table_size; i < config->table_size; ++i, index = (index + 1) % config->table_size) {
-        // read table entry
-        uint64_t old_entry = atomic_load(&entries[index]);
-        do {
-            const uint32_t old_item = old_entry;
-            const uint32_t old_version = old_entry >> 32u;
+static void hotkeys_record(lockfree_hashtable_t* table, uint64_t hash, uint64_t retries)
+{
+    hotkeys_t* hotkeys = table->hotkeys;
 
-            // mark item as deleted
-            uint32_t new_item = NULL_ITEM;
-            // increment a version
-            uint32_t new_version = old_version + 1;
-            uint64_t new_entry = ((uint64_t)new_version << 32u) | (uint64_t)new_item;
+    // the estimate is the smallest counter of the key
+    uint64_t count = UINT64_MAX;
+    for (unsigned row = 0; row < HOTKEYS_DEPTH; ++row) {
+        const size_t column = (hash >> (row * 16u)) % HOTKEYS_WIDTH;
+        const uint64_t counter = atomic_fetch_add_explicit(&hotkeys->sketch[row][column], 1, memory_order_relaxed) + 1u;
+        count = counter < count ? counter : count;
+    }
 
-            // version == 0 means free entry
-            if (old_version == 0) {
+    // update the slot of the key or take the slot of the coldest key if the key is hotter, races only make the list less exact
+    hotkeys_slot_t* coldest = &hotkeys->top[0];
+    uint64_t coldest_count = UINT64_MAX;
+    for (unsigned i = 0; i < HOTKEYS_TOP; ++i) {
+        hotkeys_slot_t* slot = &hotkeys->top[i];
+        if (atomic_load_explicit(&slot->hash, memory_order_relaxed) == hash) {
+            atomic_store_explicit(&slot->count, count, memory_order_relaxed);
+            atomic_fetch_add_explicit(&slot->retries, retries, memory_order_relaxed);
+            return;
+        }
+        const uint64_t slot_count = atomic_load_explicit(&slot->count, memory_order_relaxed);
+        if (slot_count < coldest_count) {
+            coldest = slot;
+            coldest_count = slot_count;
+        }
+    }
+    if (count > coldest_count) {
+        uint64_t coldest_hash = atomic_load_explicit(&coldest->hash, memory_order_relaxed);
+        if (atomic_compare_exchange_strong_explicit(&coldest->hash, &coldest_hash, hash, memory_order_relaxed, memory_order_relaxed)) {
+            atomic_store_explicit(&coldest->count, count, memory_order_relaxed);
+            atomic_store_explicit(&coldest->retries, retries, memory_order_relaxed);
+        }
+    }
+}
+
+// count one of "hotkeys_sampling" operations, a stored key is hashed only for sampled operations
+static void hotkeys_sample(lockfree_hashtable_t* table, const void* key, uint64_t retries)
+{
+    if (table->hotkeys == NULL) {
+        return;
+    }
+    if (hotkeys_countdown > 0) {
+        hotkeys_countdown -= 1;
+        return;
+    }
+    if (hotkeys_random == 0) {
+        hotkeys_random = fmix64((uintptr_t)&hotkeys_random) | 1u;
+    }
+    hotkeys_random ^= hotkeys_random << 13u;
+    hotkeys_random ^= hotkeys_random >> 7u;
+    hotkeys_random ^= hotkeys_random << 17u;
+    // the gap is from 0 to 2 * (sampling - 1), so one of "hotkeys_sampling" operations is sampled on average
+    hotkeys_countdown = hotkeys_random % (2 * table->config->hotkeys_sampling - 1);
+    hotkeys_record(table, calc_hotkey_hash(table, key), retries);
+}
+
+// return false if the key is not in the table for sure
+static bool filter_check(lockfree_hashtable_t* table, uint64_t hash)
+{
+    if (table->filter == NULL) {
+        return true;
+    }
+    atomic_uint64_t* block = get_filter_block(table, hash);
+    for (unsigned i = 0; i < FILTER_HASHES; ++i) {
+        const unsigned position = (hash >> (i * FILTER_POSITION_BITS)) & ((1u << FILTER_POSITION_BITS) - 1u);
+        const uint64_t word = atomic_load(&block[position / (64u / FILTER_COUNTER_BITS)]);
+        if (((word >> ((position % (64u / FILTER_COUNTER_BITS)) * FILTER_COUNTER_BITS)) & FILTER_COUNTER_MAX) == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static changefeed_slot_t* get_changefeed_slot(lockfree_hashtable_t* table, uint64_t seq)
+{
+    const lockfree_hashtable_config_t* config = table->config;
+    uint8_t* slots = (uint8_t*)((changefeed_t*)table->changefeed + 1);
+    return (changefeed_slot_t*)(slots + (seq % config->changefeed_size) * changefeed_slot_size(config));
+}
+
+// take a sequence number for a change which is going to be made, must be called after the entry was read and before the CAS,
+// so changes of the same entry get sequence numbers in the order they are made
+static uint64_t changefeed_claim(lockfree_hashtable_t* table)
+{
+    changefeed_t* changefeed = table->changefeed;
+    if (changefeed == NULL) {
+        return 0;
+    }
+    return atomic_fetch_add_explicit(&changefeed->head, 1, memory_order_relaxed);
+}
+
+// write an event with a claimed sequence number, CHANGEFEED_NOTHING is written if the change wasn't made
+static void changefeed_publish(lockfree_hashtable_t* table, uint64_t seq, unsigned type, const void* key, const void* val)
+{
+    const lockfree_hashtable_config_t* config = table->config;
+    changefeed_t* changefeed = table->changefeed;
+    if (changefeed == NULL) {
+        return;
+    }
+    changefeed_slot_t* slot = get_changefeed_slot(table, seq);
+    uint8_t* data = (uint8_t*)(slot + 1);
+    const size_t key_size = stored_key_size(config->flags, config->key_size);
+
+    // take the slot if it has an older event and nobody writes it
+    uint64_t stamp = atomic_load_explicit(&slot->stamp, memory_order_relaxed);
+    do {
+        if ((stamp & CHANGEFEED_STATE) == CHANGEFEED_WRITING || (stamp >> 2u) > seq) {
+            // the event is lost, readers see it as an overrun
+            uint64_t lost = atomic_load_explicit(&changefeed->lost, memory_order_relaxed);
+            while (lost < seq + 1 && !atomic_compare_exchange_weak(&changefeed->lost, &lost, seq + 1)) {
+            }
+            return;
+        }
+    } while (!atomic_compare_exchange_weak_explicit(&slot->stamp, &stamp, ((seq + 1) << 2u) | CHANGEFEED_WRITING, memory_order_acquire, memory_order_relaxed));
+
+    slot->type = type;
+    if (key != NULL) {
+        memcpy(data, key, key_size);
+    }
+    if (val != NULL) {
+        memcpy(data + key_size, val, config->val_size);
+    }
+    atomic_store_explicit(&slot->stamp, ((seq + 1) << 2u) | CHANGEFEED_READY, memory_order_release);
+}
+
+static magazine_t* get_magazine(lockfree_hashtable_t* table, size_t number)
+{
+    magazine_t* magazines = table->magazines;
+    return magazines + number % MAGAZINE_COUNT;
+}
+
+// number of the magazine of the thread, 0 until the thread uses a magazine
+static _Thread_local size_t magazine_number;
+
+static magazine_t* get_thread_magazine(lockfree_hashtable_t* table)
+{
+    static atomic_size_t magazine_threads;
+    if (magazine_number == 0) {
+        magazine_number = atomic_fetch_add_explicit(&magazine_threads, 1, memory_order_relaxed) + 1;
+    }
+    return get_magazine(table, magazine_number);
+}
+
+// take a magazine for a few instructions, return false if another thread has it, nobody waits for a magazine
+static bool magazine_enter(magazine_t* magazine)
+{
+    return atomic_exchange_explicit(&magazine->busy, 1, memory_order_acquire) == 0;
+}
+
+static void magazine_leave(magazine_t* magazine)
+{
+    atomic_store_explicit(&magazine->busy, 0, memory_order_release);
+}
+
+// take a record cached by the magazine, NULL_ITEM if it has none
+static uint64_t magazine_pop(magazine_t* magazine)
+{
+    if (magazine->count > 0) {
+        return magazine->freed[--magazine->count];
+    }
+    if (magazine->free != 0) {
+        const unsigned index = count_trailing_zeros(magazine->free);
+        magazine->free &= magazine->free - 1u;
+        return index + magazine->word * 64u;
+    }
+    return NULL_ITEM;
+}
+
+// reserve all free records of a pool word starting from the last word of an empty magazine, return false if the pool has no free records
+static bool magazine_refill(lockfree_hashtable_t* table, magazine_t* magazine)
+{
+    const lockfree_hashtable_config_t* config = table->config;
+    const size_t pool_size  = config->table_size / 64u + (config->table_size % 64u ? 1 : 0);
+    atomic_uint64_t* pool = table->pool;
+
+    for (size_t i = 0, word = magazine->word % pool_size; i < pool_size; ++i, word = (word + 1) % pool_size) {
+        // records after the end of the table are never free
+        const size_t records = word + 1 < pool_size || config->table_size % 64u == 0 ? 64u : config->table_size % 64u;
+        const uint64_t mask = records == 64u ? UINT64_MAX : (UINT64_C(1) << records) - 1u;
+        if ((atomic_load_explicit(&pool[word], memory_order_relaxed) & mask) == mask) {
+            continue;
+        }
+        const uint64_t reserved = ~atomic_fetch_or_explicit(&pool[word], mask, memory_order_acquire) & mask;
+        if (reserved != 0) {
+            magazine->word = word;
+            magazine->free = reserved;
+            return true;
+        }
+    }
+    return false;
+}
+
+// give records cached by the magazine back to the pool
+static void magazine_flush(lockfree_hashtable_t* table, magazine_t* magazine)
+{
+    atomic_uint64_t* pool = table->pool;
+    if (magazine->free != 0) {
+        atomic_fetch_and_explicit(&pool[magazine->word], ~magazine->free, memory_order_release);
+        magazine->free = 0;
+    }
+    for (uint64_t i = 0; i < magazine->count; ++i) {
+        atomic_fetch_and_explicit(&pool[magazine->freed[i] / 64u], ~(UINT64_C(1) << (magazine->freed[i] % 64u)), memory_order_release);
+    }
+    magazine->count = 0;
+}
+
+static uint64_t pool_allocate(lockfree_hashtable_t* table)
+{
+    const lockfree_hashtable_config_t* config = table->config;
+    const size_t pool_size  = config->table_size / 64u + (config->table_size % 64u ? 1 : 0);
+    atomic_uint64_t* pool = table->pool;
+
+    // scan and search a free bit in the pool
+    for (size_t i = 0; i < pool_size; ++i) {
+        const uint64_t chunk = atomic_load_explicit(&pool[i], memory_order_relaxed);
+        if (chunk != UINT64_MAX) {
+            for (size_t index = 0u; index < 64u; ++index) {
+                if (index + i * 64u < config->table_size) {
+                    const uint64_t bit = (UINT64_C(1) << index);
+                    if ((chunk & bit) == UINT64_C(0)) {
+                        // try to set bit
+                        if (!(atomic_fetch_or_explicit(&pool[i], bit, memory_order_acquire) & bit)) {
+                            return index + i * 64u;
+                        }
+                    }
+                } else {
+                    return NULL_ITEM;
+                }
+            }
+        }
+    }
+    return NULL_ITEM;
+}
+
+static uint64_t allocate_item(lockfree_hashtable_t* table)
+{
+    if (table->magazines == NULL) {
+        return pool_allocate(table);
+    }
+
+    uint64_t item = NULL_ITEM;
+    magazine_t* magazine = get_thread_magazine(table);
+    if (magazine_enter(magazine)) {
+        item = magazine_pop(magazine);
+        if (item == NULL_ITEM && magazine_refill(table, magazine)) {
+            item = magazine_pop(magazine);
+        }
+        magazine_leave(magazine);
+    } else {
+        // the magazine is used by another thread with the same number
+        item = pool_allocate(table);
+    }
+    // the pool is empty, take a record cached by another magazine
+    for (size_t i = 1; i < MAGAZINE_COUNT && item == NULL_ITEM; ++i) {
+        magazine_t* other = get_magazine(table, magazine_number + i);
+        if (magazine_enter(other)) {
+            item = magazine_pop(other);
+            magazine_leave(other);
+        }
+    }
+    return item;
+}
+
+static void delete_item(lockfree_hashtable_t* table, uint64_t item)
+{
+    if (item == NULL_ITEM) {
+        return;
+    }
+    atomic_uint64_t* pool = table->pool;
+    const uint64_t bit = (UINT64_C(1) << (item % 64));
+    if (table->magazines != NULL) {
+        // the record stays reserved by the magazine of the thread, records of other words go to its list until it is full
+        magazine_t* magazine = get_thread_magazine(table);
+        if (magazine_enter(magazine)) {
+            bool kept = true;
+            if (item / 64u == magazine->word) {
+                magazine->free |= bit;
+            } else if (magazine->count < MAGAZINE_FREED) {
+                magazine->freed[magazine->count++] = item;
+            } else {
+                kept = false;
+            }
+            magazine_leave(magazine);
+            if (kept) {
+                return;
+            }
+        }
+    }
+    atomic_fetch_and_explicit(&pool[item / 64], ~bit, memory_order_release);
+}
+
+static void* get_item_key(lockfree_hashtable_t* table, uint64_t item)
+{
+    const lockfree_hashtable_config_t* config = table->config;
+    uint8_t* keys = table->keys;
+    return keys + item * stored_key_size(config->flags, config->key_size);
+}
+
+static void* get_item_val(lockfree_hashtable_t* table, uint64_t item)
+{
+    const lockfree_hashtable_config_t* config = table->config;
+    uint8_t* vals = table->vals;
+    return vals + item * config->val_size;
+}
+
+// offset of the value of a record in the value file of a tiered table
+static uint64_t* get_item_locator(lockfree_hashtable_t* table, uint64_t item)
+{
+    uint64_t* vals = table->vals;
+    return vals + item;
+}
+
+static value_cache_slot_t* get_value_cache_slot(lockfree_hashtable_t* table, uint64_t locator)
+{
+    const lockfree_hashtable_config_t* config = table->config;
+    // values are appended one after another, so neighbour values go to neighbour slots
+    const uint64_t number = locator / (config->val_size ? config->val_size : 1u);
+    uint8_t* slots = (uint8_t*)((tiered_t*)table->tiered + 1);
+    return (value_cache_slot_t*)(slots + (number % config->value_cache_size) * value_cache_slot_size(config));
+}
+
+// values in the file are never changed, so a cached value is valid while the stamp of its slot is the same
+static bool value_cache_get(lockfree_hashtable_t* table, uint64_t locator, void* val)
+{
+    if (table->config->value_cache_size == 0) {
+        return false;
+    }
+    value_cache_slot_t* slot = get_value_cache_slot(table, locator);
+    const uint64_t stamp = (locator + 1u) * 2u;
+    if (atomic_load_explicit(&slot->stamp, memory_order_acquire) != stamp) {
+        return false;
+    }
+    memcpy(val, slot + 1, table->config->val_size);
+    atomic_thread_fence(memory_order_acquire);
+    return atomic_load_explicit(&slot->stamp, memory_order_relaxed) == stamp;
+}
+
+static void value_cache_put(lockfree_hashtable_t* table, uint64_t locator, const void* val)
+{
+    if (table->config->value_cache_size == 0) {
+        return;
+    }
+    value_cache_slot_t* slot = get_value_cache_slot(table, locator);
+    uint64_t stamp = atomic_load_explicit(&slot->stamp, memory_order_relaxed);
+    // skip the value if another thread writes the slot
+    if ((stamp & 1u) || !atomic_compare_exchange_strong_explicit(&slot->stamp, &stamp, stamp | 1u, memory_order_acquire, memory_order_relaxed)) {
+        return;
+    }
+    atomic_thread_fence(memory_order_release);
+    memcpy(slot + 1, val, table->config->val_size);
+    atomic_store_explicit(&slot->stamp, (locator + 1u) * 2u, memory_order_release);
+}
+
+// copy the value into a new record, a value of a tiered table is appended to the file, return false if it can't be written
+static bool store_item_val(lockfree_hashtable_t* table, uint64_t item, const void* val)
+{
+    const lockfree_hashtable_config_t* config = table->config;
+    if (table->tiered == NULL) {
+        memcpy(get_item_val(table, item), val, config->val_size);
+        return true;
+    }
+    tiered_t* tiered = table->tiered;
+    const uint64_t locator = atomic_fetch_add_explicit(&tiered->end, config->val_size, memory_order_relaxed);
+    if (!lockfree_hashtable_values_write(table->values_fd, locator, val, config->val_size)) {
+        return false;
+    }
+    *get_item_locator(table, item) = locator;
+    value_cache_put(table, locator, val);
+    return true;
+}
+
+// read a value of a tiered table from the cache or from the file
+static bool read_value(lockfree_hashtable_t* table, uint64_t locator, void* val)
+{
+    if (value_cache_get(table, locator, val)) {
+        return true;
+    }
+    if (!lockfree_hashtable_values_read(table->values_fd, locator, val, table->config->val_size)) {
+        return false;
+    }
+    value_cache_put(table, locator, val);
+    return true;
+}
+
+// copy the value of a record which may be changed at the same time, a tiered table reads it from its file
+static bool load_item_val(lockfree_hashtable_t* table, uint64_t item, void* val)
+{
+    if (table->tiered == NULL) {
+        memcpy(val, get_item_val(table, item), table->config->val_size);
+        return true;
+    }
+    return read_value(table, *get_item_locator(table, item), val);
+}
+
+// number of levels of a node
+static unsigned index_height(uint64_t item)
+{
+    unsigned height = 1;
+    while (height < INDEX_LEVELS && (item & ((UINT64_C(1) << (height * INDEX_LEVEL_BITS)) - 1u)) == 0) {
+        height += 1;
+    }
+    return height;
+}
+
+// start a new generation of a just allocated record, must be called before its key is written
+static void index_prepare(lockfree_hashtable_t* table, uint64_t item)
+{
+    const lockfree_hashtable_config_t* config = table->config;
+    if (table->index == NULL) {
+        return;
+    }
+    index_node_t* node = get_index_node(table, item);
+    // a removed node stays marked, so nobody can link a node after it
+    for (unsigned level = 0; level < index_height(item); ++level) {
+        atomic_store_explicit(get_index_link(table, item, level), INDEX_MARK | index_link(config, NULL_ITEM, 0), memory_order_relaxed);
+    }
+    const uint64_t generation = (atomic_load_explicit(&node->generation, memory_order_relaxed) + 1) & index_generation_mask(config);
+    atomic_store_explicit(&node->generation, generation, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+}
+
+// compare the node of "link" with (key, item), records with equal keys are ordered by their index,
+// return false if the record was reused while its key was read
+static bool index_compare(lockfree_hashtable_t* table, uint64_t link, const void* key, uint64_t item, int* result)
+{
+    const lockfree_hashtable_config_t* config = table->config;
+    const uint64_t node_item = index_link_item(config, link);
+    index_node_t* node = get_index_node(table, node_item);
+    if (atomic_load_explicit(&node->generation, memory_order_acquire) != index_link_generation(config, link)) {
+        return false;
+    }
+    int order = memcmp(get_item_key(table, node_item), key, config->key_size);
+    if (order == 0) {
+        order = node_item < item ? -1 : node_item > item;
+    }
+    atomic_thread_fence(memory_order_acquire);
+    if (atomic_load_explicit(&node->generation, memory_order_relaxed) != index_link_generation(config, link)) {
+        return false;
+    }
+    *result = order;
+    return true;
+}
+
+// find neighbours of (key, item) on every level: last nodes before it in "preds" and links to the next nodes in "succs",
+// removed nodes met on the way are unlinked
+static void index_find(lockfree_hashtable_t* table, const void* key, uint64_t item, uint64_t preds[INDEX_LEVELS], uint64_t succs[INDEX_LEVELS])
+{
+    const lockfree_hashtable_config_t* config = table->config;
+restart:
+    ;
+    uint64_t pred = config->table_size;
+    uint64_t pred_generation = 0;
+    for (unsigned level = INDEX_LEVELS; level-- > 0;) {
+        atomic_uint64_t* pred_link = get_index_link(table, pred, level);
+        uint64_t curr = atomic_load(pred_link);
+        if ((curr & INDEX_MARK) || !index_owned_by(config, curr, pred_generation)) {
+            // the predecessor was removed or reused meanwhile
+            goto restart;
+        }
+        while (index_link_item(config, curr) != NULL_ITEM) {
+            index_node_t* curr_node = get_index_node(table, index_link_item(config, curr));
+            atomic_uint64_t* curr_link = get_index_link(table, index_link_item(config, curr), level);
+            const uint64_t succ = atomic_load(curr_link);
+            if (atomic_load(&curr_node->generation) != index_link_generation(config, curr)) {
+                goto restart;
+            }
+            if (succ & INDEX_MARK) {
+                // the node is removed, unlink it from this level
+                const uint64_t next = index_relink(config, curr, succ);
+                if (!atomic_compare_exchange_strong(pred_link, &curr, next)) {
+                    goto restart;
+                }
+                curr = next;
+                continue;
+            }
+            int order;
+            if (!index_compare(table, curr, key, item, &order)) {
+                goto restart;
+            }
+            if (order >= 0) {
+                break;
+            }
+            pred = index_link_item(config, curr);
+            pred_generation = index_link_generation(config, curr);
+            pred_link = curr_link;
+            curr = succ;
+        }
+        preds[level] = pred;
+        succs[level] = curr;
+    }
+}
+
+// link a record into the index from the lowest level up, the record can't be removed until this returns
+static void index_insert(lockfree_hashtable_t* table, uint64_t item)
+{
+    const lockfree_hashtable_config_t* config = table->config;
+    if (table->index == NULL) {
+        return;
+    }
+    index_node_t* node = get_index_node(table, item);
+    const void* key = get_item_key(table, item);
+    const uint64_t generation = atomic_load_explicit(&node->generation, memory_order_relaxed);
+    const unsigned height = index_height(item);
+
+    uint64_t preds[INDEX_LEVELS];
+    uint64_t succs[INDEX_LEVELS];
+    index_find(table, key, item, preds, succs);
+    for (unsigned level = 0; level < height; ++level) {
+        do {
+            atomic_store(get_index_link(table, item, level), index_owned_link(config, succs[level], generation));
+            uint64_t expected = succs[level];
+            if (atomic_compare_exchange_strong(get_index_link(table, preds[level], level), &expected, index_relink(config, expected, index_link(config, item, generation)))) {
+                break;
+            }
+            index_find(table, key, item, preds, succs);
+        } while(true);
+    }
+}
+
+// remove a record from the index, when this returns the record isn't linked anymore and can be freed
+static void index_erase(lockfree_hashtable_t* table, uint64_t item)
+{
+    if (table->index == NULL || item == NULL_ITEM) {
+        return;
+    }
+    // mark links from the top, the mark of the lowest level removes the record from scans
+    for (unsigned level = index_height(item); level-- > 0;) {
+        atomic_fetch_or(get_index_link(table, item, level), INDEX_MARK);
+    }
+    // the search unlinks marked nodes on its way
+    uint64_t preds[INDEX_LEVELS];
+    uint64_t succs[INDEX_LEVELS];
+    index_find(table, get_item_key(table, item), item, preds, succs);
+}
+
+static atomic_uint32_t* get_record_epochs(lockfree_hashtable_t* table)
+{
+    return (atomic_uint32_t*)((clear_t*)table->clear + 1);
+}
+
+// a record is stale if it was inserted before the last clear
+static bool is_stale(lockfree_hashtable_t* table, uint64_t item)
+{
+    clear_t* clear = table->clear;
+    if (clear == NULL || item == NULL_ITEM) {
+        return false;
+    }
+    const uint32_t epoch = atomic_load_explicit(&clear->epoch, memory_order_acquire);
+    return atomic_load_explicit(&get_record_epochs(table)[item], memory_order_acquire) != epoch;
+}
+
+// an entry keeps the epoch it was taken in, an entry of an older epoch is free, so probes stop at it as at a never used entry
+static atomic_uint32_t* get_entry_epochs(lockfree_hashtable_t* table)
+{
+    return get_record_epochs(table) + table->config->table_size;
+}
+
+static bool is_entry_stale(lockfree_hashtable_t* table, size_t index)
+{
+    clear_t* clear = table->clear;
+    if (clear == NULL) {
+        return false;
+    }
+    const uint32_t epoch = atomic_load_explicit(&clear->epoch, memory_order_acquire);
+    return atomic_load_explicit(&get_entry_epochs(table)[index], memory_order_acquire) != epoch;
+}
+
+// move an entry into the current epoch before it is taken by an insert, epochs of entries only go forward
+static void renew_entry(lockfree_hashtable_t* table, size_t index)
+{
+    clear_t* clear = table->clear;
+    if (clear == NULL) {
+        return;
+    }
+    const uint32_t epoch = atomic_load_explicit(&clear->epoch, memory_order_acquire);
+    atomic_uint32_t* entry_epoch = &get_entry_epochs(table)[index];
+    uint32_t old_epoch = atomic_load_explicit(entry_epoch, memory_order_acquire);
+    while ((int32_t)(epoch - old_epoch) > 0 && !atomic_compare_exchange_weak(entry_epoch, &old_epoch, epoch)) {
+    }
+}
+
+// mark a record with the current epoch, must be called before the record is written into an entry
+static void set_record_epoch(lockfree_hashtable_t* table, uint64_t item)
+{
+    clear_t* clear = table->clear;
+    if (clear == NULL) {
+        return;
+    }
+    const uint32_t epoch = atomic_load_explicit(&clear->epoch, memory_order_acquire);
+    atomic_store_explicit(&get_record_epochs(table)[item], epoch, memory_order_release);
+}
+
+// replace an entry of a stale record with a deleted entry and free the record,
+// "entry" gets the current value of the entry in any case
+static void retire_stale(lockfree_hashtable_t* table, size_t index, uint64_t* entry)
+{
+    const lockfree_hashtable_config_t* config = table->config;
+    atomic_uint64_t* entries = table->entries;
+    const uint64_t item = entry_item(config, *entry);
+    const uint64_t new_entry = make_entry(config, entry_version(config, *entry) + 1, NULL_ITEM);
+    if (atomic_compare_exchange_strong(&entries[index], entry, new_entry)) {
+        if (table->filter) {
+            filter_update(table, calc_filter_hash(table, get_item_key(table, item)), -1);
+        }
+        index_erase(table, item);
+        delete_item(table, item);
+        *entry = new_entry;
+    }
+}
+
+// retire stale records of entries from "first" to "last"
+static void sweep_range(lockfree_hashtable_t* table, size_t first, size_t last)
+{
+    const lockfree_hashtable_config_t* config = table->config;
+    atomic_uint64_t* entries = table->entries;
+    for (size_t index = first; index < last; ++index) {
+        uint64_t entry = atomic_load(&entries[index]);
+        while (entry_version(config, entry) != 0 && is_stale(table, entry_item(config, entry))) {
+            retire_stale(table, index, &entry);
+        }
+    }
+}
+
+// continue the sweep after the last clear by "count" entries
+static void sweep_stale(lockfree_hashtable_t* table, size_t count)
+{
+    const lockfree_hashtable_config_t* config = table->config;
+    clear_t* clear = table->clear;
+    if (clear == NULL || atomic_load_explicit(&clear->sweep, memory_order_relaxed) >= config->table_size) {
+        return;
+    }
+    const uint64_t first = atomic_fetch_add_explicit(&clear->sweep, count, memory_order_relaxed);
+    if (first < config->table_size) {
+        sweep_range(table, first, first + count < config->table_size ? first + count : config->table_size);
+    }
+}
+
+// insert a pair starting from the "hint" slot if it is not NULL, the slot of the pair is written into "slot" if it is not NULL
+static bool insert_key(lockfree_hashtable_t* table, const void* key, const void* val, const lockfree_hashtable_slot_t* hint, lockfree_hashtable_slot_t* slot)
+{
+    const lockfree_hashtable_config_t* config = table->config;
+    atomic_uint64_t* entries = table->entries;
+    atomic_uint64_t* pool = table->pool;
+
+    sweep_stale(table, SWEEP_STEP);
+
+    // allocate a new item
+    uint64_t item = allocate_item(table);
+    if (item == NULL_ITEM && table->clear) {
+        // records of older epochs may be not swept yet
+        sweep_range(table, 0, config->table_size);
+        item = allocate_item(table);
+    }
+    if (item == NULL_ITEM) {
+        return false;
+    }
+    index_prepare(table, item);
+    set_record_epoch(table, item);
+
+    uint64_t stored_key[2];
+    const uint64_t hash = prepare_key(config->flags, config->key_size, &key, stored_key);
+    const size_t key_size = stored_key_size(config->flags, config->key_size);
+
+    // fill data from parameters
+    memcpy(get_item_key(table, item), key, key_size);
+    if (!store_item_val(table, item, val)) {
+        delete_item(table, item);
+        return false;
+    }
+
+    // the key has to be in the filter before it can be found
+    const uint64_t filter_hash = table->filter ? calc_filter_hash(table, key) : 0;
+    filter_update(table, filter_hash, 1);
+    // the record is in the index before it can be found, the old record of the key is removed after the CAS
+    index_insert(table, item);
+
+    uint64_t retries = 0;
+    // the slot seen by the caller is tried first if its entry wasn't changed or cleared, then the whole probe goes from the home entry
+    const bool at_slot = hint != NULL && !is_entry_stale(table, hint->index) && atomic_load(&entries[hint->index]) == hint->entry;
+    const size_t home = hash % config->table_size;
+    for (size_t i = at_slot ? SIZE_MAX : 0, index = at_slot ? hint->index : home; i != config->table_size; ++i, index = i == 0 ? home : (index + 1) % config->table_size) {
+        // a cleared entry is free, it is moved into the current epoch before it can be taken
+        renew_entry(table, index);
+        // read table entry
+        uint64_t old_entry = atomic_load(&entries[index]);
+        do {
+            const uint64_t old_item = entry_item(config, old_entry);
+            const uint64_t old_version = entry_version(config, old_entry);
+
+            if (old_version != 0 && is_stale(table, old_item)) {
+                // the entry was cleared, free its record and look at the entry again
+                retire_stale(table, index, &old_entry);
+                continue;
+            }
+
+            uint64_t new_item = item;
+            // increment a version
+            uint64_t new_version = old_version + 1;
+            // calc new entry
+            uint64_t new_entry = make_entry(config, new_version, new_item);
+
+            const bool can_insert = (old_version == 0) // version == 0 means free entry
+                // if entry is deleted
+                || (old_item == NULL_ITEM)
+                // if keys are equal
+                || table->key_equal(key, get_item_key(table, old_item), key_size)
+            ;
+
+            if (can_insert) {
+                const uint64_t seq = changefeed_claim(table);
+                const unsigned type = (old_version == 0 || old_item == NULL_ITEM) ? LOCKFREE_HASHTABLE_EVENT_INSERT : LOCKFREE_HASHTABLE_EVENT_OVERWRITE;
+                // try to make a CAS
+                if (atomic_compare_exchange_weak(&entries[index], &old_entry, new_entry)) {
+                    // a clear after the record was made removed the pair already
+                    changefeed_publish(table, seq, is_stale(table, item) ? CHANGEFEED_NOTHING : type, key, val);
+                    if (type == LOCKFREE_HASHTABLE_EVENT_OVERWRITE) {
+                        // the key was already counted by the filter
+                        filter_update(table, filter_hash, -1);
+                    }
+                    if (old_version > 0) {
+                        index_erase(table, old_item);
+                        delete_item(table, old_item);
+                    }
+                    hotkeys_sample(table, key, retries);
+                    if (slot != NULL) {
+                        slot->index = index;
+                        slot->entry = new_entry;
+                    }
+                    return true;
+                }
+                changefeed_publish(table, seq, CHANGEFEED_NOTHING, NULL, NULL);
+                retries += 1;
+                // if CAS was failed then try again
+            } else {
+                // check that entry wasn't changed
+                new_entry = atomic_load(&entries[index]);
+                if (new_entry == old_entry) {
+                    // if entry is same, we've found a collision, so go to the next entry
+                    break;
+                }
+                old_entry = new_entry;
+            }
+        } while(true);
+    }
+    filter_update(table, filter_hash, -1);
+    index_erase(table, item);
+    return false;
+}
+
+// find a pair, the slot of the pair is written into "slot" if it is not NULL,
+// the offset of the value of a tiered table is written into "locator" instead of reading the value if it is not NULL
+static lockfree_hashtable_find_status_t find_key(lockfree_hashtable_t* table, const void* key, void* val, lockfree_hashtable_slot_t* slot, uint64_t* locator)
+{
+    const lockfree_hashtable_config_t* config = table->config;
+    atomic_uint64_t* entries = table->entries;
+    atomic_uint64_t* pool = table->pool;
+
+    uint64_t stored_key[2];
+    const uint64_t hash = prepare_key(config->flags, config->key_size, &key, stored_key);
+    const size_t key_size = stored_key_size(config->flags, config->key_size);
+
+    hotkeys_sample(table, key, 0);
+    if (table->filter && !filter_check(table, calc_filter_hash(table, key))) {
+        return LOCKFREE_HASHTABLE_FIND_MISSING;
+    }
+
+    for (size_t i = 0, index = hash % config->table_size; i < config->table_size; ++i, index = (index + 1) % config->table_size) {
+        // an entry which wasn't taken since the last clear is free
+        if (is_entry_stale(table, index)) {
+            return LOCKFREE_HASHTABLE_FIND_MISSING;
+        }
+        // read table entry
+        uint64_t entry = atomic_load(&entries[index]);
+        do {
+            const uint64_t item = entry_item(config, entry);
+            const uint64_t version = entry_version(config, entry);
+
+            // version == 0 means free entry
+            if (version == 0) {
+                return LOCKFREE_HASHTABLE_FIND_MISSING;
+            }
+            // if entry is deleted or cleared
+            if (item == NULL_ITEM || is_stale(table, item)) {
+                break;
+            }
+            // compare keys
+            if (table->key_equal(key, get_item_key(table, item), key_size)) {
+                // copy value if "val" is not NULL, a tiered table copies the offset of the value
+                uint64_t value_locator = 0;
+                if (table->tiered) {
+                    value_locator = *get_item_locator(table, item);
+                } else if (val != NULL) {
+                    memcpy(val, get_item_val(table, item), config->val_size);
+                }
+                // check that entry wasn't changed
+                const uint64_t new_entry = atomic_load(&entries[index]);
+                if (new_entry == entry) {
+                    // if entry is same then return success
+                    if (slot != NULL) {
+                        slot->index = index;
+                        slot->entry = entry;
+                    }
+                    if (locator != NULL) {
+                        *locator = value_locator;
+                        return LOCKFREE_HASHTABLE_FIND_FOUND;
+                    }
+                    // values in the file are never changed, so the value is read after the check
+                    if (table->tiered && val != NULL && !read_value(table, value_locator, val)) {
+                        return LOCKFREE_HASHTABLE_FIND_ERROR;
+                    }
+                    return LOCKFREE_HASHTABLE_FIND_FOUND;
+                }
+                // we've found that somebody changed our entry, try again
+                entry = new_entry;
+            } else {
+                // if keys are not equal, maybe somebody changed our entry, check it
+                const uint64_t new_entry = atomic_load(&entries[index]);
+                if (new_entry == entry) {
+                    // if entry is same, so go to the next entry
+                    break;
+                }
+                entry = new_entry;
+            }
+        } while(true);
+    }
+    return LOCKFREE_HASHTABLE_FIND_MISSING;
+}
+
+// erase a pair starting from the "hint" slot if it is not NULL
+static bool erase_key(lockfree_hashtable_t* table, const void* key, const lockfree_hashtable_slot_t* hint)
+{
+    const lockfree_hashtable_config_t* config = table->config;
+    atomic_uint64_t* entries = table->entries;
+    atomic_uint64_t* pool = table->pool;
+
+    uint64_t stored_key[2];
+    const uint64_t hash = prepare_key(config->flags, config->key_size, &key, stored_key);
+    const size_t key_size = stored_key_size(config->flags, config->key_size);
+
+    uint64_t retries = 0;
+    // the slot seen by the caller is tried first if its entry wasn't changed, then the whole probe goes from the home entry
+    const bool at_slot = hint != NULL && atomic_load(&entries[hint->index]) == hint->entry;
+    const size_t home = hash % config->table_size;
+    for (size_t i = at_slot ? SIZE_MAX : 0, index = at_slot ? hint->index : home; i != config->table_size; ++i, index = i == 0 ? home : (index + 1) % config->table_size) {
+        // an entry which wasn't taken since the last clear is free
+        if (is_entry_stale(table, index)) {
+            return false;
+        }
+        // read table entry
+        uint64_t old_entry = atomic_load(&entries[index]);
+        do {
+            const uint64_t old_item = entry_item(config, old_entry);
+            const uint64_t old_version = entry_version(config, old_entry);
+
+            // mark item as deleted
+            uint64_t new_item = NULL_ITEM;
+            // increment a version
+            uint64_t new_version = old_version + 1;
+            uint64_t new_entry = make_entry(config, new_version, new_item);
+
+            // version == 0 means free entry
+            if (old_version == 0) {
                 return false;
             }
-            // if entry is deleted
-            if (old_item == NULL_ITEM) {
+            // if entry is deleted or cleared
+            if (old_item == NULL_ITEM || is_stale(table, old_item)) {
+                break;
+            }
+
+            // compare keys
+            if (table->key_equal(key, get_item_key(table, old_item), key_size)) {
+                const uint64_t seq = changefeed_claim(table);
+                // try to make a CAS
+                if (atomic_compare_exchange_weak(&entries[index], &old_entry, new_entry)) {
+                    changefeed_publish(table, seq, LOCKFREE_HASHTABLE_EVENT_ERASE, key, NULL);
+                    if (table->filter) {
+                        filter_update(table, calc_filter_hash(table, key), -1);
+                    }
+                    index_erase(table, old_item);
+                    delete_item(table, old_item);
+                    hotkeys_sample(table, key, retries);
+                    return true;
+                }
+                changefeed_publish(table, seq, CHANGEFEED_NOTHING, NULL, NULL);
+                retries += 1;
+                // if CAS was failed then try again
+            } else {
+                // check that entry wasn't changed
+                new_entry = atomic_load(&entries[index]);
+                if (new_entry == old_entry) {
+                    // if entry is same, so go to the next entry
+                    break;
+                }
+                // we've found that somebody changed our entry, try again
+                old_entry = new_entry;
+            }
+        } while(true);
+    }
+    return false;
+}
+
+bool lockfree_hashtable_insert(lockfree_hashtable_t* table, const void* key, const void* val)
+{
+    return insert_key(table, key, val, NULL, NULL);
+}
+
+bool lockfree_hashtable_insert_slot(lockfree_hashtable_t* table, const void* key, const void* val, lockfree_hashtable_slot_t* slot)
+{
+    return insert_key(table, key, val, NULL, slot);
+}
+
+bool lockfree_hashtable_update_at(lockfree_hashtable_t* table, lockfree_hashtable_slot_t* slot, const void* key, const void* val)
+{
+    return insert_key(table, key, val, slot, slot);
+}
+
+bool lockfree_hashtable_find(lockfree_hashtable_t* table, const void* key, void* val)
+{
+    return find_key(table, key, val, NULL, NULL) == LOCKFREE_HASHTABLE_FIND_FOUND;
+}
+
+lockfree_hashtable_find_status_t lockfree_hashtable_lookup(lockfree_hashtable_t* table, const void* key, void* val)
+{
+    return find_key(table, key, val, NULL, NULL);
+}
+
+bool lockfree_hashtable_find_slot(lockfree_hashtable_t* table, const void* key, void* val, lockfree_hashtable_slot_t* slot)
+{
+    return find_key(table, key, val, slot, NULL) == LOCKFREE_HASHTABLE_FIND_FOUND;
+}
+
+bool lockfree_hashtable_erase(lockfree_hashtable_t* table, const void* key)
+{
+    return erase_key(table, key, NULL);
+}
+
+void lockfree_hashtable_set_values_file(lockfree_hashtable_t* table, int fd)
+{
+    table->values_fd = fd;
+}
+
+size_t lockfree_hashtable_find_batch(lockfree_hashtable_t* table, const void* const* keys, void* const* vals, lockfree_hashtable_find_status_t* statuses, size_t count)
+{
+    // reads of values and positions of their keys
+    lockfree_hashtable_value_read_t* reads = table->tiered ? malloc(count * (sizeof(lockfree_hashtable_value_read_t) + sizeof(size_t))) : NULL;
+    if (reads == NULL) {
+        size_t result = 0;
+        for (size_t i = 0; i < count; ++i) {
+            statuses[i] = find_key(table, keys[i], vals[i], NULL, NULL);
+            result += statuses[i] == LOCKFREE_HASHTABLE_FIND_FOUND;
+        }
+        return result;
+    }
+
+    // find offsets of all values first, values which aren't in the cache are read by one batch
+    size_t* positions = (size_t*)(reads + count);
+    size_t read_count = 0;
+    for (size_t i = 0; i < count; ++i) {
+        uint64_t locator;
+        statuses[i] = find_key(table, keys[i], NULL, NULL, &locator);
+        if (statuses[i] == LOCKFREE_HASHTABLE_FIND_FOUND && vals[i] != NULL && !value_cache_get(table, locator, vals[i])) {
+            lockfree_hashtable_value_read_t read = {locator, vals[i], table->config->val_size, false};
+            positions[read_count] = i;
+            reads[read_count++] = read;
+        }
+    }
+    lockfree_hashtable_values_read_batch(table->values_fd, reads, read_count);
+
+    for (size_t read = 0; read < read_count; ++read) {
+        statuses[positions[read]] = reads[read].done ? LOCKFREE_HASHTABLE_FIND_FOUND : LOCKFREE_HASHTABLE_FIND_ERROR;
+        if (reads[read].done) {
+            value_cache_put(table, reads[read].offset, reads[read].data);
+        }
+    }
+    size_t result = 0;
+    for (size_t i = 0; i < count; ++i) {
+        result += statuses[i] == LOCKFREE_HASHTABLE_FIND_FOUND;
+    }
+    free(reads);
+    return result;
+}
+
+bool lockfree_hashtable_erase_at(lockfree_hashtable_t* table, const lockfree_hashtable_slot_t* slot, const void* key)
+{
+    return erase_key(table, key, slot);
+}
+
+// one part of the work split between threads
+typedef void (*parallel_part_t)(void* context, size_t part);
+
+typedef struct {
+    parallel_part_t run;
+    void* context;
+    size_t part;
+} parallel_task_t;
+
+static int parallel_task(void* arg)
+{
+    const parallel_task_t* task = arg;
+    task->run(task->context, task->part);
+    return 0;
+}
+
+// run parts 0..count-1 on their own threads and wait for them, the calling thread takes part 0,
+// a part whose thread can't be started is run here, all parts are run here if there is no memory for the threads
+static void parallel_run(size_t count, parallel_part_t run, void* context)
+{
+    parallel_task_t* tasks = malloc(count * sizeof(parallel_task_t));
+    thrd_t* threads = malloc(count * sizeof(thrd_t));
+    if (tasks == NULL || threads == NULL) {
+        free(threads);
+        free(tasks);
+        for (size_t i = 0; i < count; ++i) {
+            run(context, i);
+        }
+        return;
+    }
+
+    threads[0] = thrd_current();
+    for (size_t i = 1; i < count; ++i) {
+        parallel_task_t task = {run, context, i};
+        tasks[i] = task;
+        if (thrd_create(&threads[i], parallel_task, &tasks[i]) != thrd_success) {
+            run(context, i);
+            threads[i] = threads[0];
+        }
+    }
+    run(context, 0);
+    for (size_t i = 1; i < count; ++i) {
+        if (!thrd_equal(threads[i], threads[0])) {
+            thrd_join(threads[i], NULL);
+        }
+    }
+    free(threads);
+    free(tasks);
+}
+
+// pair was dropped as a duplicate, stored in the highest bit of its home slot
+#define BULK_DROPPED ((size_t)1 << (sizeof(size_t) * CHAR_BIT - 1))
+
+typedef struct {
+    lockfree_hashtable_t* table;
+    const uint8_t* data;
+    size_t count;
+    lockfree_hashtable_duplicate_policy_t policy;
+    size_t thread_count;
+    // home slot of every pair
+    size_t* homes;
+    // pair indexes grouped by partitions
+    size_t* order;
+    // [thread][partition] counters, after the prefix sum: positions in "order"
+    size_t* histogram;
+    // first position of every partition in "order", thread_count + 1 items
+    size_t* segments;
+    // number of pairs of every partition which don't fit into its slots
+    size_t* deferred;
+    atomic_bool failed;
+} bulk_load_t;
+
+// first slot of a partition, partition "thread_count" is the end of the table
+static size_t bulk_partition_begin(const bulk_load_t* load, size_t partition)
+{
+    return partition * load->table->config->table_size / load->thread_count;
+}
+
+static size_t bulk_partition(const bulk_load_t* load, size_t home)
+{
+    return ((home + 1) * load->thread_count - 1) / load->table->config->table_size;
+}
+
+static const uint8_t* bulk_pair(const bulk_load_t* load, size_t pair)
+{
+    const lockfree_hashtable_config_t* config = load->table->config;
+    return load->data + pair * (config->key_size + config->val_size);
+}
+
+typedef enum {
+    BULK_PLACED,
+    BULK_DEFERRED,
+    BULK_DUPLICATE
+} bulk_place_result_t;
+
+// put a pair into a free slot between its home and "last" with plain stores,
+// "wrap" allows to go around the end of the table
+static bulk_place_result_t bulk_place(bulk_load_t* load, uint64_t item, size_t last, bool wrap)
+{
+    lockfree_hashtable_t* table = load->table;
+    const lockfree_hashtable_config_t* config = table->config;
+    atomic_uint64_t* entries = table->entries;
+    const void* key = get_item_key(table, item);
+
+    for (size_t i = 0, index = load->homes[item]; i < config->table_size; ++i) {
+        const uint64_t entry = atomic_load_explicit(&entries[index], memory_order_relaxed);
+        const uint64_t old_item = entry_item(config, entry);
+        const uint64_t old_version = entry_version(config, entry);
+
+        if (old_version == 0) {
+            atomic_store_explicit(&entries[index], make_entry(config, 1, item), memory_order_relaxed);
+            renew_entry(table, index);
+            return BULK_PLACED;
+        }
+        if (table->key_equal(key, get_item_key(table, old_item), stored_key_size(config->flags, config->key_size))) {
+            switch (load->policy) {
+                case LOCKFREE_HASHTABLE_BULK_KEEP_LAST:
+                    atomic_store_explicit(&entries[index], make_entry(config, old_version + 1, item), memory_order_relaxed);
+                    load->homes[old_item] |= BULK_DROPPED;
+                    return BULK_PLACED;
+                case LOCKFREE_HASHTABLE_BULK_KEEP_FIRST:
+                    load->homes[item] |= BULK_DROPPED;
+                    return BULK_PLACED;
+                default:
+                    return BULK_DUPLICATE;
+            }
+        }
+
+        index += 1;
+        if (index == last && !wrap) {
+            return BULK_DEFERRED;
+        }
+        index %= config->table_size;
+    }
+    return BULK_DEFERRED;
+}
+
+// copy pairs of the thread's chunk into records, calc their home slots and count them by partitions
+static void bulk_load_copy(void* context, size_t part)
+{
+    bulk_load_t* load = context;
+    lockfree_hashtable_t* table = load->table;
+    const lockfree_hashtable_config_t* config = table->config;
+    size_t* histogram = load->histogram + part * load->thread_count;
+
+    const size_t first = part * load->count / load->thread_count;
+    const size_t last = (part + 1) * load->count / load->thread_count;
+    for (size_t item = first; item < last; ++item) {
+        const uint8_t* pair = bulk_pair(load, item);
+        const void* key = pair;
+        uint64_t stored_key[2];
+        const size_t home = prepare_key(config->flags, config->key_size, &key, stored_key) % config->table_size;
+
+        memcpy(get_item_key(table, item), key, stored_key_size(config->flags, config->key_size));
+        if (!store_item_val(table, item, pair + config->key_size)) {
+            atomic_store(&load->failed, true);
+        }
+
+        load->homes[item] = home;
+        histogram[bulk_partition(load, home)] += 1;
+    }
+}
+
+// spread pair indexes of the thread's chunk to their partitions, pairs keep the input order inside a partition
+static void bulk_load_scatter(void* context, size_t part)
+{
+    bulk_load_t* load = context;
+    size_t* positions = load->histogram + part * load->thread_count;
+
+    const size_t first = part * load->count / load->thread_count;
+    const size_t last = (part + 1) * load->count / load->thread_count;
+    for (size_t item = first; item < last; ++item) {
+        load->order[positions[bulk_partition(load, load->homes[item])]++] = item;
+    }
+}
+
+// place pairs of the thread's partition into the partition's slots,
+// pairs which run out of the partition are moved to the beginning of its segment
+static void bulk_load_place(void* context, size_t part)
+{
+    bulk_load_t* load = context;
+    const size_t first = load->segments[part];
+    const size_t last = load->segments[part + 1];
+    const size_t end = bulk_partition_begin(load, part + 1);
+
+    size_t deferred = 0;
+    for (size_t position = first; position < last; ++position) {
+        const size_t item = load->order[position];
+        switch (bulk_place(load, item, end, false)) {
+            case BULK_DEFERRED:
+                load->order[first + deferred++] = item;
                 break;
+            case BULK_DUPLICATE:
+                atomic_store_explicit(&load->failed, true, memory_order_relaxed);
+                return;
+            default:
+                break;
+        }
+    }
+    load->deferred[part] = deferred;
+}
+
+// mark records of all placed pairs as used
+static void bulk_load_mark(void* context, size_t part)
+{
+    bulk_load_t* load = context;
+    atomic_uint64_t* pool = load->table->pool;
+
+    const size_t words = load->count / 64u + (load->count % 64u ? 1 : 0);
+    const size_t first = part * words / load->thread_count;
+    const size_t last = (part + 1) * words / load->thread_count;
+    for (size_t i = first; i < last; ++i) {
+        uint64_t chunk = 0;
+        for (size_t index = 0; index < 64u && index + i * 64u < load->count; ++index) {
+            if (!(load->homes[index + i * 64u] & BULK_DROPPED)) {
+                chunk |= UINT64_C(1) << index;
+                if (load->table->filter) {
+                    filter_update(load->table, calc_filter_hash(load->table, get_item_key(load->table, index + i * 64u)), 1);
+                }
+                index_prepare(load->table, index + i * 64u);
+                set_record_epoch(load->table, index + i * 64u);
+                index_insert(load->table, index + i * 64u);
             }
+        }
+        atomic_store_explicit(&pool[i], chunk, memory_order_relaxed);
+    }
+}
 
-            // compare keys
-            if (memcmp(key, get_item_key(table, old_item), config->key_size) == 0) {
-                // try to make a CAS
-                if (atomic_compare_exchange_weak(&entries[index], &old_entry, new_entry)) {
-                    delete_item(table, old_item);
-                    return true;
+bool lockfree_hashtable_bulk_load(lockfree_hashtable_t* table, const void* data, size_t count, lockfree_hashtable_duplicate_policy_t policy, size_t thread_count)
+{
+    const lockfree_hashtable_config_t* config = table->config;
+    if (count > config->table_size) {
+        return false;
+    }
+    if (count == 0) {
+        return true;
+    }
+    if (thread_count == 0) {
+        thread_count = 1;
+    }
+
+    bulk_load_t load = {
+        .table = table,
+        .data = data,
+        .count = count,
+        .policy = policy,
+        .thread_count = thread_count,
+    };
+    atomic_init(&load.failed, false);
+
+    load.homes = malloc(count * sizeof(size_t));
+    load.order = malloc(count * sizeof(size_t));
+    load.histogram = calloc(thread_count * thread_count + (thread_count + 1) + thread_count, sizeof(size_t));
+
+    bool result = false;
+    if (load.homes && load.order && load.histogram) {
+        load.segments = load.histogram + thread_count * thread_count;
+        load.deferred = load.segments + thread_count + 1;
+
+        parallel_run(thread_count, bulk_load_copy, &load);
+
+        // turn counters into positions: partitions go one after another, threads inside a partition keep the input order
+        size_t position = 0;
+        for (size_t partition = 0; partition < thread_count; ++partition) {
+            load.segments[partition] = position;
+            for (size_t thread = 0; thread < thread_count; ++thread) {
+                const size_t counter = load.histogram[thread * thread_count + partition];
+                load.histogram[thread * thread_count + partition] = position;
+                position += counter;
+            }
+        }
+        load.segments[thread_count] = position;
+
+        parallel_run(thread_count, bulk_load_scatter, &load);
+        parallel_run(thread_count, bulk_load_place, &load);
+
+        // pairs which didn't fit into their partitions go around the table, the amount is small so do it here
+        for (size_t partition = 0; partition < thread_count && !atomic_load(&load.failed); ++partition) {
+            for (size_t i = 0; i < load.deferred[partition]; ++i) {
+                if (bulk_place(&load, load.order[load.segments[partition] + i], 0, true) != BULK_PLACED) {
+                    atomic_store(&load.failed, true);
+                    break;
                 }
-                // if CAS was failed then try again
-            } else {
-                // check that entry wasn't changed
-                new_entry = atomic_load(&entries[index]);
-                if (new_entry == old_entry) {
-                    // if entry is same, so go to the next entry
+            }
+        }
+
+        if (!atomic_load(&load.failed)) {
+            parallel_run(thread_count, bulk_load_mark, &load);
+            result = true;
+        }
+    }
+
+    free(load.histogram);
+    free(load.order);
+    free(load.homes);
+    return result;
+}
+
+typedef struct {
+    lockfree_hashtable_t* table;
+    lockfree_hashtable_predicate_t predicate;
+    void* context;
+    size_t thread_count;
+    // a value of a tiered table is read into the buffer of the part for the predicate
+    uint8_t* vals;
+    atomic_size_t erased;
+} erase_if_t;
+
+// sweep one part of the entries
+static void erase_if_sweep(void* context, size_t part)
+{
+    erase_if_t* erase_if = context;
+    lockfree_hashtable_t* table = erase_if->table;
+    const lockfree_hashtable_config_t* config = table->config;
+    atomic_uint64_t* entries = table->entries;
+    void* buffer = erase_if->vals + part * config->val_size;
+    const size_t first = part * config->table_size / erase_if->thread_count;
+    const size_t last = (part + 1) * config->table_size / erase_if->thread_count;
+    size_t erased = 0;
+
+    for (size_t index = first; index < last; ++index) {
+        if (is_entry_stale(table, index)) {
+            continue;
+        }
+        uint64_t entry = atomic_load(&entries[index]);
+        do {
+            const uint64_t item = entry_item(config, entry);
+            const uint64_t version = entry_version(config, entry);
+            // skip free, deleted and cleared entries
+            if (version == 0 || item == NULL_ITEM || is_stale(table, item)) {
+                break;
+            }
+            const void* key = get_item_key(table, item);
+            const void* val = get_item_val(table, item);
+            if (table->tiered) {
+                // a value which can't be read is kept
+                val = load_item_val(table, item, buffer) ? buffer : NULL;
+            }
+            // the record may be reused while the predicate reads it, then the CAS fails and the new record is checked
+            if (val == NULL || !erase_if->predicate(key, val, erase_if->context)) {
+                const uint64_t new_entry = atomic_load(&entries[index]);
+                if (new_entry == entry) {
                     break;
                 }
-                // we've found that somebody changed our entry, try again
-                old_entry = new_entry;
+                entry = new_entry;
+                continue;
+            }
+            const uint64_t seq = changefeed_claim(table);
+            if (atomic_compare_exchange_weak(&entries[index], &entry, make_entry(config, version + 1, NULL_ITEM))) {
+                changefeed_publish(table, seq, LOCKFREE_HASHTABLE_EVENT_ERASE, key, NULL);
+                if (table->filter) {
+                    filter_update(table, calc_filter_hash(table, key), -1);
+                }
+                index_erase(table, item);
+                delete_item(table, item);
+                erased += 1;
+                break;
             }
+            changefeed_publish(table, seq, CHANGEFEED_NOTHING, NULL, NULL);
         } while(true);
     }
+    atomic_fetch_add_explicit(&erase_if->erased, erased, memory_order_relaxed);
+}
+
+size_t lockfree_hashtable_erase_if(lockfree_hashtable_t* table, lockfree_hashtable_predicate_t predicate, void* context, size_t thread_count)
+{
+    const lockfree_hashtable_config_t* config = table->config;
+    if (thread_count == 0) {
+        thread_count = 1;
+    }
+    // a buffer for a value of every thread
+    uint8_t* vals = malloc(thread_count * (config->val_size ? config->val_size : 1u));
+    if (vals == NULL) {
+        return 0;
+    }
+
+    erase_if_t erase_if = {
+        .table = table,
+        .predicate = predicate,
+        .context = context,
+        .thread_count = thread_count,
+        .vals = vals,
+    };
+    atomic_init(&erase_if.erased, 0);
+    parallel_run(thread_count, erase_if_sweep, &erase_if);
+    free(vals);
+    return atomic_load(&erase_if.erased);
+}
+
+// snapshot starts with this header, then go bucket_count + 1 record positions and packed records (key then value)
+typedef struct {
+    uint64_t magic;
+    uint64_t flags;
+    uint64_t key_size;
+    uint64_t val_size;
+    uint64_t count;
+    uint64_t bucket_count;
+} frozen_header_t;
+
+#define FROZEN_MAGIC UINT64_C(0x315a52465448464c) // "LFHTFRZ1"
+
+static size_t frozen_bucket_count(size_t count)
+{
+    // power of two, not less than number of records, so a bucket has one record on average
+    size_t bucket_count = 1;
+    while (bucket_count < count) {
+        bucket_count <<= 1u;
+    }
+    return bucket_count;
+}
+
+static size_t frozen_mem_size(const lockfree_hashtable_config_t* config, size_t count)
+{
+    const size_t buckets = (frozen_bucket_count(count) + 1) * sizeof(uint64_t);
+    const size_t records = roundup(count * (stored_key_size(config->flags, config->key_size) + config->val_size), sizeof(uint64_t));
+    return sizeof(frozen_header_t) + buckets + records;
+}
+
+// return record of the entry, NULL_ITEM if the entry is free, deleted or cleared
+static uint64_t get_entry_item(lockfree_hashtable_t* table, size_t index)
+{
+    atomic_uint64_t* entries = table->entries;
+    const uint64_t entry = atomic_load_explicit(&entries[index], memory_order_acquire);
+    if (entry_version(table->config, entry) == 0 || is_entry_stale(table, index) || is_stale(table, entry_item(table->config, entry))) {
+        return NULL_ITEM;
+    }
+    return entry_item(table->config, entry);
+}
+
+size_t lockfree_hashtable_freeze_calc_mem_size(lockfree_hashtable_t* table)
+{
+    const lockfree_hashtable_config_t* config = table->config;
+    size_t count = 0;
+    for (size_t index = 0; index < config->table_size; ++index) {
+        count += get_entry_item(table, index) != NULL_ITEM;
+    }
+    return frozen_mem_size(config, count);
+}
+
+size_t lockfree_hashtable_freeze(lockfree_hashtable_t* table, void* memory, size_t size)
+{
+    const lockfree_hashtable_config_t* config = table->config;
+    const size_t key_size = stored_key_size(config->flags, config->key_size);
+    const size_t record_size = key_size + config->val_size;
+
+    size_t count = 0;
+    for (size_t index = 0; index < config->table_size; ++index) {
+        count += get_entry_item(table, index) != NULL_ITEM;
+    }
+    const size_t mem_size = frozen_mem_size(config, count);
+    if (mem_size > size) {
+        return 0;
+    }
+
+    frozen_header_t* header = memory;
+    header->magic = FROZEN_MAGIC;
+    // flags which change how records are hashed
+    header->flags = config->flags & (LOCKFREE_HASHTABLE_HASHED_KEYS | LOCKFREE_HASHTABLE_WIDE_INDEX);
+    header->key_size = config->key_size;
+    header->val_size = config->val_size;
+    header->count = count;
+    header->bucket_count = frozen_bucket_count(count);
+
+    const size_t mask = header->bucket_count - 1;
+    uint64_t* buckets = (uint64_t*)(header + 1);
+    uint8_t* records = (uint8_t*)(buckets + header->bucket_count + 1);
+    memset(buckets, 0, (header->bucket_count + 1) * sizeof(uint64_t));
+
+    // count records of every bucket, then make positions where buckets start
+    for (size_t index = 0; index < config->table_size; ++index) {
+        const uint64_t item = get_entry_item(table, index);
+        if (item != NULL_ITEM) {
+            buckets[(calc_stored_key_hash(config->flags, get_item_key(table, item), key_size) & mask) + 1] += 1;
+        }
+    }
+    for (size_t bucket = 1; bucket <= header->bucket_count; ++bucket) {
+        buckets[bucket] += buckets[bucket - 1];
+    }
+
+    // copy records, a bucket position moves to the start of the next bucket, so shift them back after that
+    for (size_t index = 0; index < config->table_size; ++index) {
+        const uint64_t item = get_entry_item(table, index);
+        if (item != NULL_ITEM) {
+            const void* key = get_item_key(table, item);
+            uint8_t* record = records + buckets[calc_stored_key_hash(config->flags, key, key_size) & mask]++ * record_size;
+            memcpy(record, key, key_size);
+            if (!load_item_val(table, item, record + key_size)) {
+                // a value of a tiered table can't be read
+                header->magic = 0;
+                return 0;
+            }
+        }
+    }
+    memmove(buckets + 1, buckets, header->bucket_count * sizeof(uint64_t));
+    buckets[0] = 0;
+
+    return mem_size;
+}
+
+bool lockfree_hashtable_frozen_open(lockfree_hashtable_frozen_t* frozen, const void* memory, size_t size)
+{
+    const frozen_header_t* header = memory;
+    if (size < sizeof(frozen_header_t) || header->magic != FROZEN_MAGIC) {
+        return false;
+    }
+    if (header->bucket_count != frozen_bucket_count(header->count)) {
+        return false;
+    }
+    const lockfree_hashtable_config_t config = {
+        .key_size = header->key_size,
+        .val_size = header->val_size,
+        .flags = header->flags,
+    };
+    if (size < frozen_mem_size(&config, header->count)) {
+        return false;
+    }
+
+    frozen->key_size = header->key_size;
+    frozen->val_size = header->val_size;
+    frozen->flags = header->flags;
+    frozen->key_equal = lockfree_hashtable_select_key_equal(stored_key_size(frozen->flags, frozen->key_size), lockfree_hashtable_detect_isa());
+    frozen->bucket_mask = header->bucket_count - 1;
+    frozen->buckets = (const uint64_t*)(header + 1);
+    frozen->records = (const uint8_t*)(frozen->buckets + header->bucket_count + 1);
+    return true;
+}
+
+bool lockfree_hashtable_frozen_find(const lockfree_hashtable_frozen_t* frozen, const void* key, void* val)
+{
+    uint64_t stored_key[2];
+    const size_t bucket = prepare_key(frozen->flags, frozen->key_size, &key, stored_key) & frozen->bucket_mask;
+    const size_t key_size = stored_key_size(frozen->flags, frozen->key_size);
+    const size_t record_size = key_size + frozen->val_size;
+
+    const uint8_t* record = frozen->records + frozen->buckets[bucket] * record_size;
+    const uint8_t* last = frozen->records + frozen->buckets[bucket + 1] * record_size;
+    for (; record != last; record += record_size) {
+        if (frozen->key_equal(key, record, key_size)) {
+            if (val != NULL) {
+                memcpy(val, record + key_size, frozen->val_size);
+            }
+            return true;
+        }
+    }
     return false;
 }
+
+uint64_t lockfree_hashtable_changefeed_position(lockfree_hashtable_t* table)
+{
+    changefeed_t* changefeed = table->changefeed;
+    if (changefeed == NULL) {
+        return 0;
+    }
+    return atomic_load_explicit(&changefeed->head, memory_order_acquire);
+}
+
+lockfree_hashtable_changefeed_status_t lockfree_hashtable_changefeed_read(lockfree_hashtable_t* table, uint64_t* cursor, lockfree_hashtable_event_t* event, void* key, void* val)
+{
+    const lockfree_hashtable_config_t* config = table->config;
+    changefeed_t* changefeed = table->changefeed;
+    if (changefeed == NULL) {
+        return LOCKFREE_HASHTABLE_CHANGEFEED_EMPTY;
+    }
+    const size_t key_size = stored_key_size(config->flags, config->key_size);
+
+    while (true) {
+        const uint64_t seq = *cursor;
+        if (atomic_load_explicit(&changefeed->head, memory_order_acquire) - seq > config->changefeed_size) {
+            return LOCKFREE_HASHTABLE_CHANGEFEED_OVERRUN;
+        }
+
+        changefeed_slot_t* slot = get_changefeed_slot(table, seq);
+        const uint8_t* data = (const uint8_t*)(slot + 1);
+        const uint64_t stamp = atomic_load_explicit(&slot->stamp, memory_order_acquire);
+        if ((stamp >> 2u) > seq + 1) {
+            return LOCKFREE_HASHTABLE_CHANGEFEED_OVERRUN;
+        }
+        if (stamp != (((seq + 1) << 2u) | CHANGEFEED_READY)) {
+            // the event isn't written yet, or it won't be written at all
+            if (atomic_load_explicit(&changefeed->lost, memory_order_acquire) > seq) {
+                return LOCKFREE_HASHTABLE_CHANGEFEED_OVERRUN;
+            }
+            return LOCKFREE_HASHTABLE_CHANGEFEED_EMPTY;
+        }
+
+        const unsigned type = slot->type;
+        if (type != CHANGEFEED_NOTHING) {
+            event->seq = seq;
+            event->type = type;
+            if (type != LOCKFREE_HASHTABLE_EVENT_CLEAR) {
+                memcpy(key, data, key_size);
+            }
+            if (type != LOCKFREE_HASHTABLE_EVENT_ERASE && val != NULL) {
+                memcpy(val, data + key_size, config->val_size);
+            }
+        }
+        // check that the slot wasn't taken by a newer event while we were reading it
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&slot->stamp, memory_order_relaxed) != stamp) {
+            return LOCKFREE_HASHTABLE_CHANGEFEED_OVERRUN;
+        }
+
+        *cursor = seq + 1;
+        if (type != CHANGEFEED_NOTHING) {
+            return LOCKFREE_HASHTABLE_CHANGEFEED_EVENT;
+        }
+    }
+}
+
+bool lockfree_hashtable_may_contain(lockfree_hashtable_t* table, const void* key)
+{
+    const lockfree_hashtable_config_t* config = table->config;
+    if (table->filter == NULL) {
+        return true;
+    }
+    uint64_t stored_key[2];
+    prepare_key(config->flags, config->key_size, &key, stored_key);
+    return filter_check(table, calc_filter_hash(table, key));
+}
+
+// link to the first node after (key, item), NULL key means the beginning of the index
+static uint64_t index_seek(lockfree_hashtable_t* table, const void* key, uint64_t item)
+{
+    if (key == NULL) {
+        return atomic_load(&get_index_node(table, table->config->table_size)->link) & ~INDEX_MARK;
+    }
+    uint64_t preds[INDEX_LEVELS];
+    uint64_t succs[INDEX_LEVELS];
+    index_find(table, key, item, preds, succs);
+    return succs[0];
+}
+
+bool lockfree_hashtable_clear(lockfree_hashtable_t* table)
+{
+    clear_t* clear = table->clear;
+    if (clear == NULL) {
+        return false;
+    }
+    const uint64_t seq = changefeed_claim(table);
+    atomic_fetch_add_explicit(&clear->epoch, 1, memory_order_acq_rel);
+    // records of older epochs are freed by next inserts
+    atomic_store_explicit(&clear->sweep, 0, memory_order_relaxed);
+    changefeed_publish(table, seq, LOCKFREE_HASHTABLE_EVENT_CLEAR, NULL, NULL);
+    return true;
+}
+
+void lockfree_hashtable_release_magazine(lockfree_hashtable_t* table)
+{
+    if (table->magazines == NULL) {
+        return;
+    }
+    // records of a magazine used by another thread right now stay in it
+    magazine_t* magazine = get_thread_magazine(table);
+    if (magazine_enter(magazine)) {
+        magazine_flush(table, magazine);
+        magazine_leave(magazine);
+    }
+}
+
+size_t lockfree_hashtable_range(lockfree_hashtable_t* table, const void* first, const void* last, lockfree_hashtable_visit_t visit, void* context)
+{
+    const lockfree_hashtable_config_t* config = table->config;
+    if (table->index == NULL) {
+        return 0;
+    }
+    // copy of the current pair and the key of the last visited pair
+    uint8_t* buffer = malloc(config->key_size * 2 + config->val_size);
+    if (buffer == NULL) {
+        return 0;
+    }
+    uint8_t* key = buffer;
+    uint8_t* val = buffer + config->key_size;
+    uint8_t* previous = val + config->val_size;
+
+    size_t count = 0;
+    uint64_t link = index_seek(table, first, 0);
+    while (index_link_item(config, link) != NULL_ITEM) {
+        const uint64_t item = index_link_item(config, link);
+        index_node_t* node = get_index_node(table, item);
+
+        uint64_t next = 0;
+        bool stale = false;
+        uint64_t locator = 0;
+        bool valid = atomic_load_explicit(&node->generation, memory_order_acquire) == index_link_generation(config, link);
+        if (valid) {
+            stale = is_stale(table, item);
+            memcpy(key, get_item_key(table, item), config->key_size);
+            if (table->tiered) {
+                locator = *get_item_locator(table, item);
+            } else {
+                memcpy(val, get_item_val(table, item), config->val_size);
+            }
+            next = atomic_load(&node->link);
+            atomic_thread_fence(memory_order_acquire);
+            valid = atomic_load_explicit(&node->generation, memory_order_relaxed) == index_link_generation(config, link);
+        }
+        if (!valid) {
+            // the record was reused, continue after the last visited key
+            link = count ? index_seek(table, previous, NULL_ITEM) : index_seek(table, first, 0);
+            continue;
+        }
+
+        if (last != NULL && memcmp(key, last, config->key_size) > 0) {
+            break;
+        }
+        // marked records are erased or overwritten, the old and the new record of an overwritten key go one after another
+        if (!(next & INDEX_MARK) && !stale && (count == 0 || memcmp(key, previous, config->key_size) != 0)) {
+            // a value of a tiered table is read after the check of the record, a pair with a value which can't be read is skipped
+            if (table->tiered && !read_value(table, locator, val)) {
+                link = next & ~INDEX_MARK;
+                continue;
+            }
+            count += 1;
+            memcpy(previous, key, config->key_size);
+            if (!visit(key, val, context)) {
+                break;
+            }
+        }
+        link = next & ~INDEX_MARK;
+    }
+    free(buffer);
+    return count;
+}
+
+// hottest keys go first
+static int hotkeys_compare(const void* a, const void* b)
+{
+    const lockfree_hashtable_hotkey_t* hotkey1 = a;
+    const lockfree_hashtable_hotkey_t* hotkey2 = b;
+    return hotkey1->count < hotkey2->count ? 1 : hotkey1->count > hotkey2->count ? -1 : 0;
+}
+
+size_t lockfree_hashtable_hotkeys(lockfree_hashtable_t* table, lockfree_hashtable_hotkey_t* hotkeys, size_t count)
+{
+    hotkeys_t* tracker = table->hotkeys;
+    if (tracker == NULL) {
+        return 0;
+    }
+    lockfree_hashtable_hotkey_t top[HOTKEYS_TOP];
+    size_t size = 0;
+    for (unsigned i = 0; i < HOTKEYS_TOP; ++i) {
+        hotkeys_slot_t* slot = &tracker->top[i];
+        top[size].hash = atomic_load_explicit(&slot->hash, memory_order_relaxed);
+        top[size].count = atomic_load_explicit(&slot->count, memory_order_relaxed);
+        top[size].retries = atomic_load_explicit(&slot->retries, memory_order_relaxed);
+        if (top[size].hash == 0 || top[size].count == 0) {
+            continue;
+        }
+        // two threads may put the same key into two slots
+        size_t same = 0;
+        while (same < size && top[same].hash != top[size].hash) {
+            same += 1;
+        }
+        if (same < size) {
+            top[same].count = top[same].count > top[size].count ? top[same].count : top[size].count;
+            top[same].retries += top[size].retries;
+        } else {
+            size += 1;
+        }
+    }
+    qsort(top, size, sizeof(top[0]), hotkeys_compare);
+
+    size = size < count ? size : count;
+    memcpy(hotkeys, top, size * sizeof(top[0]));
+    return size;
+}
+
+void lockfree_hashtable_hotkeys_reset(lockfree_hashtable_t* table)
+{
+    hotkeys_t* hotkeys = table->hotkeys;
+    if (hotkeys == NULL) {
+        return;
+    }
+    for (unsigned i = 0; i < HOTKEYS_TOP; ++i) {
+        atomic_store_explicit(&hotkeys->top[i].count, 0, memory_order_relaxed);
+        atomic_store_explicit(&hotkeys->top[i].retries, 0, memory_order_relaxed);
+        atomic_store_explicit(&hotkeys->top[i].hash, 0, memory_order_relaxed);
+    }
+    for (unsigned row = 0; row < HOTKEYS_DEPTH; ++row) {
+        for (unsigned column = 0; column < HOTKEYS_WIDTH; ++column) {
+            atomic_store_explicit(&hotkeys->sketch[row][column], 0, memory_order_relaxed);
+        }
+    }
+}
+
+uint64_t lockfree_hashtable_key_hash(lockfree_hashtable_t* table, const void* key)
+{
+    const lockfree_hashtable_config_t* config = table->config;
+    uint64_t stored_key[2];
+    prepare_key(config->flags, config->key_size, &key, stored_key);
+    return calc_hotkey_hash(table, key);
+}
@@ -3,40 +3,246 @@
 #include <stdlib.h>
 #include <stdint.h>
 
+// records keep a 128 bit hash of a key instead of the key itself, keys are compared by their hashes
+#define LOCKFREE_HASHTABLE_HASHED_KEYS (1u << 0)
+// keep an ordered index of records for range scans, keys are ordered by memcmp, not used together with LOCKFREE_HASHTABLE_HASHED_KEYS
+#define LOCKFREE_HASHTABLE_ORDERED_INDEX (1u << 1)
+// entries keep 40 bit record indexes and 24 bit versions instead of 32 and 32 bits, so a table can have more than 2^32 records
+#define LOCKFREE_HASHTABLE_WIDE_INDEX (1u << 2)
+// the table can be cleared by lockfree_hashtable_clear while it is used, records and entries keep the epoch they were written in
+#define LOCKFREE_HASHTABLE_CLEARABLE (1u << 3)
+// threads cache free records in magazines inside the table memory: a magazine reserves free records a pool word (64 records) at a time
+// and keeps records freed by its thread, so inserts and erases usually don't change the shared pool,
+// records cached by other magazines are taken when the pool is empty
+#define LOCKFREE_HASHTABLE_MAGAZINES (1u << 4)
+// values are appended to a file given by lockfree_hashtable_set_values_file, records keep 8 byte offsets of values,
+// the file only grows, space of overwritten and erased values is not reused
+#define LOCKFREE_HASHTABLE_TIERED_VALUES (1u << 5)
+
 typedef struct {
     size_t table_size;
     size_t key_size;
     size_t val_size;
+    // LOCKFREE_HASHTABLE_* flags
+    unsigned flags;
+    // number of the latest changes kept for readers of the change feed, 0 turns the change feed off
+    size_t changefeed_size;
+    // size in bytes of the filter which answers most finds of absent keys without probing the table, 0 turns the filter off,
+    // 4 bytes per record give about 3% false positives
+    size_t filter_size;
+    // one of "hotkeys_sampling" operations is counted by the tracker of hot keys, 0 turns the tracker off
+    size_t hotkeys_sampling;
+    // number of values of a LOCKFREE_HASHTABLE_TIERED_VALUES table cached in memory, 0 turns the cache off
+    size_t value_cache_size;
 } lockfree_hashtable_config_t;
 
+// compare two keys of "key_size" bytes
+typedef bool (*lockfree_hashtable_key_equal_t)(const void* key1, const void* key2, size_t key_size);
+
 typedef struct {
     const lockfree_hashtable_config_t* config;
+    // chosen for the key size and the CPU when the handle is made
+    lockfree_hashtable_key_equal_t key_equal;
     void* entries;
     void* keys;
     void* vals;
     void* pool;
+    void* changefeed;
+    void* filter;
+    void* index;
+    void* hotkeys;
+    void* clear;
+    void* tiered;
+    void* magazines;
+    // file of values of a LOCKFREE_HASHTABLE_TIERED_VALUES table, -1 until lockfree_hashtable_set_values_file
+    int values_fd;
 } lockfree_hashtable_t;
 
+typedef enum {
+    LOCKFREE_HASHTABLE_EVENT_INSERT = 1,
+    LOCKFREE_HASHTABLE_EVENT_OVERWRITE,
+    LOCKFREE_HASHTABLE_EVENT_ERASE,
+    // all pairs were removed by lockfree_hashtable_clear, the event has no key
+    LOCKFREE_HASHTABLE_EVENT_CLEAR
+} lockfree_hashtable_event_type_t;
+
+typedef struct {
+    uint64_t seq;
+    lockfree_hashtable_event_type_t type;
+} lockfree_hashtable_event_t;
+
+typedef enum {
+    // an event was read
+    LOCKFREE_HASHTABLE_CHANGEFEED_EVENT,
+    // no new events yet
+    LOCKFREE_HASHTABLE_CHANGEFEED_EMPTY,
+    // events after the cursor were overwritten or lost, the reader has to start again from a full scan
+    LOCKFREE_HASHTABLE_CHANGEFEED_OVERRUN
+} lockfree_hashtable_changefeed_status_t;
+
+// key found by the tracker of hot keys
+typedef struct {
+    // hash of the key, see lockfree_hashtable_key_hash
+    uint64_t hash;
+    // estimated number of sampled operations with the key
+    uint64_t count;
+    // CAS retries of sampled inserts and erases of the key
+    uint64_t retries;
+} lockfree_hashtable_hotkey_t;
+
+// read-only snapshot of a table, see lockfree_hashtable_freeze
+typedef struct {
+    size_t key_size;
+    size_t val_size;
+    unsigned flags;
+    lockfree_hashtable_key_equal_t key_equal;
+    size_t bucket_mask;
+    const uint64_t* buckets;
+    const uint8_t* records;
+} lockfree_hashtable_frozen_t;
+
+// what lockfree_hashtable_bulk_load does when the same key occurs more than once in the input
+typedef enum {
+    // the last pair wins, same as inserting the pairs one by one
+    LOCKFREE_HASHTABLE_BULK_KEEP_LAST,
+    // the first pair wins, later duplicates are dropped
+    LOCKFREE_HASHTABLE_BULK_KEEP_FIRST,
+    // loading fails
+    LOCKFREE_HASHTABLE_BULK_FAIL
+} lockfree_hashtable_duplicate_policy_t;
+
+// result of lockfree_hashtable_lookup and lockfree_hashtable_find_batch for one key
+typedef enum {
+    // the key is in the table and its value was copied
+    LOCKFREE_HASHTABLE_FIND_FOUND,
+    // the key is not in the table
+    LOCKFREE_HASHTABLE_FIND_MISSING,
+    // the key is in the table but its value can't be read from the file of a LOCKFREE_HASHTABLE_TIERED_VALUES table
+    LOCKFREE_HASHTABLE_FIND_ERROR
+} lockfree_hashtable_find_status_t;
+
+// slot of a pair returned by lockfree_hashtable_find_slot and lockfree_hashtable_insert_slot:
+// index of the table entry and the entry value seen, the entry changes with every change of the slot
+typedef struct {
+    size_t index;
+    uint64_t entry;
+} lockfree_hashtable_slot_t;
+
+// called by lockfree_hashtable_range for every pair in the range, return false to stop the scan
+typedef bool (*lockfree_hashtable_visit_t)(const void* key, const void* val, void* context);
+
+// called by lockfree_hashtable_erase_if for every pair, return true to erase the pair
+typedef bool (*lockfree_hashtable_predicate_t)(const void* key, const void* val, void* context);
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-// calculate needed size of hash table memory
+// calculate needed size of hash table memory, return 0 if the table is too big for its index width
 size_t lockfree_hashtable_calc_mem_size(const lockfree_hashtable_config_t* config);
 
 // init hash table, no additional allocates, no thread safe
+// the config is copied into the memory together with offsets of all parts, the memory has no pointers inside
 void lockfree_hashtable_init(lockfree_hashtable_t* table, const lockfree_hashtable_config_t* config, void* memory);
 
+// make a handle for a table initialized in "memory" by lockfree_hashtable_init, e.g. in shared memory of another process
+// or at another address, return false if "memory" doesn't contain an initialized table, thread safe
+bool lockfree_hashtable_attach(lockfree_hashtable_t* table, void* memory);
+
 // insert a new entry to the table, return true if success, return false if the table is full
 bool lockfree_hashtable_insert(lockfree_hashtable_t* table, const void* key, const void* val);
 
+// fill a just initialized table from "count" pairs stored one after another in "data" (key_size bytes of key then val_size bytes of value),
+// the work is split by hash between "thread_count" threads, no thread safe, loaded pairs don't go to the change feed
+// return false if pairs don't fit into the table, a duplicate was found with LOCKFREE_HASHTABLE_BULK_FAIL
+// or a temporary buffer can't be allocated, the table has to be initialized again in that case
+bool lockfree_hashtable_bulk_load(lockfree_hashtable_t* table, const void* data, size_t count, lockfree_hashtable_duplicate_policy_t policy, size_t thread_count);
+
+// remove all pairs in constant time by starting a new epoch, records of older epochs read as empty
+// and are freed by later inserts, thread safe, return false if the table isn't LOCKFREE_HASHTABLE_CLEARABLE
+bool lockfree_hashtable_clear(lockfree_hashtable_t* table);
+
+// give records cached by the magazine of the calling thread back to the pool, thread safe, the records stay cached
+// if another thread uses the magazine at the moment, not needed before the table memory is freed
+void lockfree_hashtable_release_magazine(lockfree_hashtable_t* table);
+
+// give a LOCKFREE_HASHTABLE_TIERED_VALUES table the file of its values opened for reading and writing, no thread safe,
+// every handle made by lockfree_hashtable_init or lockfree_hashtable_attach needs it, inserts fail and finds don't find without it
+void lockfree_hashtable_set_values_file(lockfree_hashtable_t* table, int fd);
+
 // find an entry by key, return true if entry is preset in table, false otherwise
 // if "val" is NULL, no value will be copied, just return true if entry is preset
 bool lockfree_hashtable_find(lockfree_hashtable_t* table, const void* key, void* val);
 
+// same as lockfree_hashtable_find, but tells a key whose value can't be read from the file from a missing key
+lockfree_hashtable_find_status_t lockfree_hashtable_lookup(lockfree_hashtable_t* table, const void* key, void* val);
+
+// find "count" keys, statuses[i] tells if keys[i] is in the table, its value is copied into vals[i] if it is not NULL,
+// values of a LOCKFREE_HASHTABLE_TIERED_VALUES table which aren't in the cache are read from the file at once,
+// by io_uring where it is supported and by pread otherwise, thread safe, return number of found keys,
+// the call returns when all reads are done: one submission already replaces a syscall per key, and waiting for the reads
+// outside of the call would need the ring of the thread, the keys and the buffers to stay untouched after it
+size_t lockfree_hashtable_find_batch(lockfree_hashtable_t* table, const void* const* keys, void* const* vals, lockfree_hashtable_find_status_t* statuses, size_t count);
+
+// check the filter of absent keys only, return false if the key is not in the table for sure,
+// return true if the key may be in the table or the filter is off
+bool lockfree_hashtable_may_contain(lockfree_hashtable_t* table, const void* key);
+
 // remove an entry by key from hash table, return true if entry was deleted, false if entry not found
 bool lockfree_hashtable_erase(lockfree_hashtable_t* table, const void* key);
 
+// erase every pair for which "predicate" returns true, the entries are split between "thread_count" threads,
+// thread safe, "predicate" may be called from all of them at the same time and is called again for a pair changed during the call,
+// with LOCKFREE_HASHTABLE_HASHED_KEYS it gets the hash of a key, return number of erased pairs, 0 if buffers can't be allocated
+size_t lockfree_hashtable_erase_if(lockfree_hashtable_t* table, lockfree_hashtable_predicate_t predicate, void* context, size_t thread_count);
+
+// same as lockfree_hashtable_insert and lockfree_hashtable_find, the slot of the pair is written into "slot" on success
+bool lockfree_hashtable_insert_slot(lockfree_hashtable_t* table, const void* key, const void* val, lockfree_hashtable_slot_t* slot);
+bool lockfree_hashtable_find_slot(lockfree_hashtable_t* table, const void* key, void* val, lockfree_hashtable_slot_t* slot);
+
+// overwrite or erase the pair of "key" by a CAS on its slot without probing from the home entry of the key,
+// make the whole probe if the slot was changed since it was returned, "key" must be the key of the slot
+// lockfree_hashtable_update_at writes the new slot of the pair into "slot", return values are the same as of insert and erase
+bool lockfree_hashtable_update_at(lockfree_hashtable_t* table, lockfree_hashtable_slot_t* slot, const void* key, const void* val);
+bool lockfree_hashtable_erase_at(lockfree_hashtable_t* table, const lockfree_hashtable_slot_t* slot, const void* key);
+
+// copy up to "count" hottest keys into "hotkeys" starting from the hottest one, thread safe
+// return number of copied keys, 0 if the tracker of hot keys is off
+size_t lockfree_hashtable_hotkeys(lockfree_hashtable_t* table, lockfree_hashtable_hotkey_t* hotkeys, size_t count);
+
+// forget counted operations, operations running at the same time may be counted partially, thread safe
+void lockfree_hashtable_hotkeys_reset(lockfree_hashtable_t* table);
+
+// hash of a key as it is reported by lockfree_hashtable_hotkeys
+uint64_t lockfree_hashtable_key_hash(lockfree_hashtable_t* table, const void* key);
+
+// call "visit" in the order of keys for pairs with keys from "first" to "last" inclusive, NULL means no bound,
+// a key is visited once, pairs changed during the scan may be visited with the old or the new value or skipped, thread safe
+// return number of visited pairs, 0 if the table has no ordered index
+size_t lockfree_hashtable_range(lockfree_hashtable_t* table, const void* first, const void* last, lockfree_hashtable_visit_t visit, void* context);
+
+// sequence number of the next change, a reader starts from it as a cursor and then makes a full scan of the table,
+// changes made during the scan are read from the change feed after it
+uint64_t lockfree_hashtable_changefeed_position(lockfree_hashtable_t* table);
+
+// read the next change after "cursor" and move the cursor, key is copied in the form it is stored in records,
+// value is copied for inserts and overwrites if "val" is not NULL, thread safe, every reader has its own cursor
+lockfree_hashtable_changefeed_status_t lockfree_hashtable_changefeed_read(lockfree_hashtable_t* table, uint64_t* cursor, lockfree_hashtable_event_t* event, void* key, void* val);
+
+// calculate needed size of a snapshot of the table
+size_t lockfree_hashtable_freeze_calc_mem_size(lockfree_hashtable_t* table);
+
+// write a read-only snapshot of the table into "memory", the snapshot has no pointers inside so it can be stored into a file and mapped back,
+// could run together with lockfree_hashtable_find, no thread safe with other operations
+// return size of the snapshot, 0 if it doesn't fit into "size" bytes
+size_t lockfree_hashtable_freeze(lockfree_hashtable_t* table, void* memory, size_t size);
+
+// open a snapshot written by lockfree_hashtable_freeze, return false if "memory" doesn't contain a snapshot
+bool lockfree_hashtable_frozen_open(lockfree_hashtable_frozen_t* frozen, const void* memory, size_t size);
+
+// find an entry in a snapshot, same as lockfree_hashtable_find, thread safe
+bool lockfree_hashtable_frozen_find(const lockfree_hashtable_frozen_t* frozen, const void* key, void* val);
+
 #ifdef __cplusplus
 }
 #endif
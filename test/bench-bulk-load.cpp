@@ -0,0 +1,98 @@
+#include <memory>
+#include <vector>
+#include <future>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+
+#include <lockfree-hashtable.h>
+#include "misc.hpp"
+
+int main(int argc, char** argv)
+{
+    const std::size_t key_size = 64;
+    const std::size_t val_size = 128;
+    const std::size_t table_size = size_arg(argc, argv, "--table-size", 150'000'000);
+    const std::size_t item_count = size_arg(argc, argv, "--item-count", 100'000'000);
+    const std::size_t thread_count = 16;
+    const lockfree_hashtable_config_t config = {
+        table_size,
+        key_size,
+        val_size,
+        table_size >= UINT32_MAX ? LOCKFREE_HASHTABLE_WIDE_INDEX : 0u
+    };
+
+    std::random_device random;
+
+    const auto mem_size = lockfree_hashtable_calc_mem_size(&config);
+    if (mem_size == 0) {
+        std::cout << "table size " << table_size << " is not supported" << std::endl;
+        return 1;
+    }
+    const auto data_size = item_count * (key_size + val_size);
+    std::cout << "used memory: " << ((mem_size + data_size) / (1024.0 * 1024.0 * 1024.0)) << " Gb" << std::endl;
+    std::unique_ptr<std::uint8_t[]> memory(new std::uint8_t[mem_size]);
+    std::unique_ptr<std::uint8_t[]> data(new std::uint8_t[data_size]);
+
+    lockfree_hashtable_t table;
+    lockfree_hashtable_init(&table, &config, memory.get());
+
+    auto do_parallel = [&] (auto& function, std::size_t size) {
+        std::vector<std::future<void>> threads;
+        threads.reserve(thread_count);
+
+        const auto chunk_size = size / thread_count;
+        for (std::size_t i = 0; i < thread_count; ++i) {
+            threads.emplace_back(std::async(std::launch::async, function, random(), i * chunk_size, chunk_size));
+        }
+        if (thread_count * chunk_size < size) {
+            function(random(), thread_count * chunk_size, size - thread_count * chunk_size);
+        }
+        for (auto& th: threads) {
+            th.get();
+        }
+    };
+
+    auto generate = [&] (std::random_device::result_type seed, std::size_t prefix, std::size_t size) {
+        std::mt19937 generator{seed};
+        generate_random_key_val_data(&data[prefix * (key_size + val_size)], prefix, size, key_size, val_size, generator);
+    };
+    auto check = [&] (std::random_device::result_type, std::size_t prefix, std::size_t size) {
+        std::unique_ptr<std::uint8_t[]> value(new std::uint8_t[val_size]);
+        for (std::size_t i = prefix; i < prefix + size; ++i) {
+            auto* key = &data[i * (key_size + val_size)];
+            auto* val = &data[i * (key_size + val_size) + key_size];
+            if (!lockfree_hashtable_find(&table, key, value.get())) {
+                throw std::runtime_error("error find element");
+            }
+            if (std::memcmp(val, value.get(), val_size) != 0) {
+                throw std::runtime_error("error compare element");
+            }
+        }
+    };
+
+    do_parallel(generate, item_count);
+    {
+        auto start = std::chrono::steady_clock::now();
+
+        if (!lockfree_hashtable_bulk_load(&table, data.get(), item_count, LOCKFREE_HASHTABLE_BULK_KEEP_LAST, thread_count)) {
+            throw std::runtime_error("error bulk load");
+        }
+
+        auto finish = std::chrono::steady_clock::now();
+        double elapsed_seconds = std::chrono::duration_cast<std::chrono::duration<double>>(finish - start).count();
+        std::cout << std::setprecision (15) << "bulk load(" << item_count / elapsed_seconds << " items per second, "
+                  << data_size / elapsed_seconds / (1024.0 * 1024.0 * 1024.0) << " Gb per second) estimated: " << elapsed_seconds << " seconds" << std::endl;
+    }
+    {
+        auto start = std::chrono::steady_clock::now();
+
+        do_parallel(check, item_count);
+
+        auto finish = std::chrono::steady_clock::now();
+        double elapsed_seconds = std::chrono::duration_cast<std::chrono::duration<double>>(finish - start).count();
+        std::cout << std::setprecision (15) << "check (" << item_count / elapsed_seconds << ") estimated: " << elapsed_seconds << " seconds" << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,62 @@
+#include <memory>
+#include <vector>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+
+#include <lockfree-hashtable-compare.h>
+#include "misc.hpp"
+
+int main()
+{
+    const std::size_t key_count = 1024;
+    const std::size_t rounds = 20'000;
+    const std::pair<lockfree_hashtable_isa_t, const char*> isas[] = {
+        {LOCKFREE_HASHTABLE_ISA_GENERIC, "memcmp"},
+        {LOCKFREE_HASHTABLE_ISA_SCALAR,  "scalar"},
+        {LOCKFREE_HASHTABLE_ISA_SSE2,    "sse2"},
+        {LOCKFREE_HASHTABLE_ISA_AVX2,    "avx2"},
+        {LOCKFREE_HASHTABLE_ISA_AVX512,  "avx512"},
+    };
+
+    std::mt19937 generator{std::random_device{}()};
+    const auto supported = lockfree_hashtable_detect_isa();
+
+    for (const std::size_t key_size: {8, 16, 32, 64, 128}) {
+        // pairs of keys which are equal, except the last byte of every second pair, like a probe over colliding entries
+        std::vector<std::uint8_t> keys1(key_count * key_size);
+        std::vector<std::uint8_t> keys2(key_count * key_size);
+        for (std::size_t i = 0; i < key_count; ++i) {
+            random_string(i, std::span(&keys1[i * key_size], key_size), generator);
+        }
+        keys2 = keys1;
+        for (std::size_t i = 0; i < key_count; i += 2) {
+            keys2[i * key_size + key_size - 1] ^= 1;
+        }
+
+        for (auto [isa, name]: isas) {
+            if (isa > supported) {
+                continue;
+            }
+            const auto key_equal = lockfree_hashtable_select_key_equal(key_size, isa);
+            std::size_t equal = 0;
+
+            auto start = std::chrono::steady_clock::now();
+            for (std::size_t r = 0; r < rounds; ++r) {
+                for (std::size_t i = 0; i < key_count; ++i) {
+                    equal += key_equal(&keys1[i * key_size], &keys2[i * key_size], key_size);
+                }
+            }
+            auto finish = std::chrono::steady_clock::now();
+            double elapsed_seconds = std::chrono::duration_cast<std::chrono::duration<double>>(finish - start).count();
+
+            if (equal != rounds * key_count / 2) {
+                throw std::runtime_error("error compare keys");
+            }
+            std::cout << std::setprecision (4) << "key size " << std::setw(3) << key_size << ", " << std::setw(6) << name << ": "
+                      << elapsed_seconds * 1e9 / (rounds * key_count) << " ns per compare" << std::endl;
+        }
+    }
+
+    return 0;
+}
@@ -7,28 +7,38 @@
 
 #include <lockfree-hashtable.h>
 #include "misc.hpp"
+#include "perf-counters.hpp"
 
-int main()
+int main(int argc, char** argv)
 {
+    perf_counters::parse_args(argc, argv);
+
     const std::size_t key_size = 64;
     const std::size_t val_size = 128;
-    const std::size_t table_size = 1'250'000;
-    const std::size_t item_count = 1'000'000;
+    const std::size_t table_size = size_arg(argc, argv, "--table-size", 1'250'000);
+    const std::size_t item_count = size_arg(argc, argv, "--item-count", 1'000'000);
     const std::size_t thread_count = 16;
     const std::size_t chunk_size = 8192;
     const std::size_t count_interval = 1'000'000;
     const lockfree_hashtable_config_t config = {
         table_size,
         key_size,
-        val_size
+        val_size,
+        (table_size >= UINT32_MAX ? LOCKFREE_HASHTABLE_WIDE_INDEX : 0u) | (flag_arg(argc, argv, "--magazines") ? LOCKFREE_HASHTABLE_MAGAZINES : 0u)
     };
 
     std::mutex m;
+    perf_counter_values insert_perf;
+    perf_counter_values check_perf;
     std::random_device random;
     std::string find;
     find.resize(val_size, ' ');
 
     const auto mem_size = lockfree_hashtable_calc_mem_size(&config);
+    if (mem_size == 0) {
+        std::cout << "table size " << table_size << " is not supported" << std::endl;
+        return 1;
+    }
     std::cout << "used memory: " << (mem_size / (1024.0 * 1024.0 * 1024.0)) << " Gb" << std::endl;
     std::unique_ptr<std::uint8_t[]> memory(new std::uint8_t[mem_size]);
 
@@ -39,6 +49,7 @@ int main()
         std::size_t count = 0;
         double time = 0;
         std::mt19937 generator{seed};
+        perf_counters perf;
         
         const auto mem_size = chunk_size * (key_size + val_size);
         std::unique_ptr<std::uint8_t[]> data(new std::uint8_t[mem_size]);
@@ -46,6 +57,7 @@ int main()
         for (std::size_t c = 0; c < size / chunk_size; ++c) {
             generate_random_key_val_data(data.get(), prefix + c * chunk_size, chunk_size, key_size, val_size, generator);
             auto start = std::chrono::steady_clock::now();
+            perf.start();
             for (std::size_t i = 0; i < chunk_size; ++i) {
                 auto* key = &data[i * (key_size + val_size)];
                 auto* val = &data[i * (key_size + val_size) + key_size];
@@ -54,6 +66,7 @@ int main()
                 }
                 count += 1;
             }
+            perf.stop();
             auto finish = std::chrono::steady_clock::now();
             double elapsed_seconds = std::chrono::duration_cast<std::chrono::duration<double>>(finish - start).count();
             time += elapsed_seconds;
@@ -61,6 +74,7 @@ int main()
         if (size % chunk_size) {
             generate_random_key_val_data(data.get(), prefix + (size / chunk_size) * chunk_size, size % chunk_size, key_size, val_size, generator);
             auto start = std::chrono::steady_clock::now();
+            perf.start();
             for (std::size_t i = 0; i < size % chunk_size; ++i) {
                 auto* key = &data[i * (key_size + val_size)];
                 auto* val = &data[i * (key_size + val_size) + key_size];
@@ -69,16 +83,22 @@ int main()
                 }
                 count += 1;
             }
+            perf.stop();
             auto finish = std::chrono::steady_clock::now();
             double elapsed_seconds = std::chrono::duration_cast<std::chrono::duration<double>>(finish - start).count();
             time += elapsed_seconds;
         }
+        {
+            std::lock_guard lk(m);
+            insert_perf += perf.values();
+        }
         return count / time;
     };
     auto check = [&] (std::random_device::result_type seed, std::size_t prefix, std::size_t size) {
         std::size_t count = 0;
         double time = 0;
         std::mt19937 generator{seed};
+        perf_counters perf;
         std::unique_ptr<std::uint8_t[]> value(new std::uint8_t[val_size]);
 
         const auto mem_size = chunk_size * (key_size + val_size);
@@ -87,6 +107,7 @@ int main()
         for (std::size_t c = 0; c < size / chunk_size; ++c) {
             generate_random_key_val_data(data.get(), prefix + c * chunk_size, chunk_size, key_size, val_size, generator);
             auto start = std::chrono::steady_clock::now();
+            perf.start();
             for (std::size_t i = 0; i < chunk_size; ++i) {
                 auto* key = &data[i * (key_size + val_size)];
                 auto* val = &data[i * (key_size + val_size) + key_size];
@@ -98,6 +119,7 @@ int main()
                 }
                 count += 1;
             }
+            perf.stop();
             auto finish = std::chrono::steady_clock::now();
             double elapsed_seconds = std::chrono::duration_cast<std::chrono::duration<double>>(finish - start).count();
             time += elapsed_seconds;
@@ -105,6 +127,7 @@ int main()
         if (size % chunk_size) {
             generate_random_key_val_data(data.get(), prefix + (size / chunk_size) * chunk_size, size % chunk_size, key_size, val_size, generator);
             auto start = std::chrono::steady_clock::now();
+            perf.start();
             for (std::size_t i = 0; i < size % chunk_size; ++i) {
                 auto* key = &data[i * (key_size + val_size)];
                 auto* val = &data[i * (key_size + val_size) + key_size];
@@ -116,10 +139,15 @@ int main()
                 }
                 count += 1;
             }
+            perf.stop();
             auto finish = std::chrono::steady_clock::now();
             double elapsed_seconds = std::chrono::duration_cast<std::chrono::duration<double>>(finish - start).count();
             time += elapsed_seconds;
         }
+        {
+            std::lock_guard lk(m);
+            check_perf += perf.values();
+        }
         return count / time;
     };
     auto do_parallel = [&] (std::random_device::result_type seed, auto& function, std::size_t size) {
@@ -149,6 +177,7 @@ int main()
         auto finish = std::chrono::steady_clock::now();
         double elapsed_seconds = std::chrono::duration_cast<std::chrono::duration<double>>(finish - start).count();
         std::cout << std::setprecision (15) << "insert(" << result << ") estimated: " << elapsed_seconds << " seconds" << std::endl;
+        print_perf_counters(std::cout, "insert", insert_perf, item_count);
     }
     {
         auto start = std::chrono::steady_clock::now();
@@ -158,6 +187,7 @@ int main()
         auto finish = std::chrono::steady_clock::now();
         double elapsed_seconds = std::chrono::duration_cast<std::chrono::duration<double>>(finish - start).count();
         std::cout << std::setprecision (15) << "check (" << result << ") estimated: " << elapsed_seconds << " seconds" << std::endl;
+        print_perf_counters(std::cout, "check", check_perf, item_count);
     }
     {
         auto insert_and_check = [&] (std::random_device::result_type seed, std::size_t prefix) {
@@ -167,8 +197,11 @@ int main()
             std::unique_ptr<std::uint8_t[]> data(new std::uint8_t[key_size + val_size]);
             std::unique_ptr<std::uint8_t[]> value(new std::uint8_t[val_size]);
             std::mt19937 generator{seed};
+            perf_counters perf;
+            std::size_t total_count = 0;
             generate_random_key_val_data(data.get(), prefix, 1, key_size, val_size, generator);
             for (;; count = 0) {
+                perf.start();
                 for (; count < count_interval; ++count) {
                     auto* key = &data[0];
                     auto* val = &data[key_size];
@@ -198,9 +231,12 @@ int main()
                         }
                     }
                 }
+                perf.stop();
+                total_count += count;
                 std::lock_guard lk(m);
                 std::cout << std::setprecision (15) << "insert speed: " << count / insert_time << " items per second" << std::endl;
                 std::cout << std::setprecision (15) << "find speed: " << count / find_time << " items per second" << std::endl;
+                print_perf_counters(std::cout, "insert and find", perf.values(), total_count);
             }
         };
         std::vector<std::future<void>> threads;
@@ -0,0 +1,149 @@
+#include <memory>
+#include <vector>
+
+#include <catch2/catch_all.hpp>
+#include <lockfree-hashtable.h>
+#include "misc.hpp"
+
+static std::vector<std::uint8_t> pack_pairs(const std::vector<std::pair<std::string, std::string>>& pairs)
+{
+    std::vector<std::uint8_t> data;
+    for (auto& [key, val]: pairs) {
+        data.insert(data.end(), key.begin(), key.end());
+        data.insert(data.end(), val.begin(), val.end());
+    }
+    return data;
+}
+
+TEST_CASE("bulk load table", "[bulk_load][find]") {
+    const std::size_t key_size = 64;
+    const std::size_t val_size = 128;
+    const std::size_t table_size = GENERATE(1, 7, 17, 1000, 100'000);
+    const std::size_t thread_count = GENERATE(1, 2, 3, 7);
+    const lockfree_hashtable_config_t config = {
+        table_size,
+        key_size,
+        val_size
+    };
+
+    std::mt19937 generator{std::random_device{}()};
+    std::string find;
+    find.resize(val_size, ' ');
+
+    std::unique_ptr<std::uint8_t[]> memory(new std::uint8_t[lockfree_hashtable_calc_mem_size(&config)]);
+
+    lockfree_hashtable_t table;
+    lockfree_hashtable_init(&table, &config, memory.get());
+
+    SECTION("full table") {
+        const auto random_data = generate_random_data(table_size, key_size, val_size, generator);
+        const auto data = pack_pairs(random_data);
+
+        REQUIRE(lockfree_hashtable_bulk_load(&table, data.data(), random_data.size(), LOCKFREE_HASHTABLE_BULK_FAIL, thread_count));
+        for (auto& [key, val]: random_data) {
+            REQUIRE(lockfree_hashtable_find(&table, key.data(), find.data()));
+            REQUIRE(find == val);
+        }
+
+        const auto key = random_string("key_1", key_size, generator);
+        const auto val = random_string("val1", val_size, generator);
+        REQUIRE(!lockfree_hashtable_find(&table, key.data(), nullptr));
+        REQUIRE(!lockfree_hashtable_insert(&table, key.data(), val.data()));
+    }
+
+    SECTION("partially filled table") {
+        const auto random_data = generate_random_data(table_size * 3 / 4, key_size, val_size, generator);
+        const auto data = pack_pairs(random_data);
+
+        REQUIRE(lockfree_hashtable_bulk_load(&table, data.data(), random_data.size(), LOCKFREE_HASHTABLE_BULK_FAIL, thread_count));
+        for (auto& [key, val]: random_data) {
+            REQUIRE(lockfree_hashtable_find(&table, key.data(), find.data()));
+            REQUIRE(find == val);
+        }
+
+        SECTION("erase and insert after load") {
+            for (std::size_t i = 0; i < random_data.size(); i += 2) {
+                REQUIRE(lockfree_hashtable_erase(&table, random_data[i].first.data()));
+            }
+            for (std::size_t i = 0; i < table_size - random_data.size() + random_data.size() / 2; ++i) {
+                const auto key = random_string("key_" + std::to_string(i) + "_", key_size, generator);
+                const auto val = random_string("val1", val_size, generator);
+                REQUIRE(lockfree_hashtable_insert(&table, key.data(), val.data()));
+            }
+            for (std::size_t i = 1; i < random_data.size(); i += 2) {
+                REQUIRE(lockfree_hashtable_find(&table, random_data[i].first.data(), find.data()));
+                REQUIRE(find == random_data[i].second);
+            }
+        }
+    }
+
+    SECTION("too many pairs") {
+        const auto random_data = generate_random_data(table_size + 1, key_size, val_size, generator);
+        const auto data = pack_pairs(random_data);
+
+        REQUIRE(!lockfree_hashtable_bulk_load(&table, data.data(), random_data.size(), LOCKFREE_HASHTABLE_BULK_KEEP_LAST, thread_count));
+    }
+}
+
+TEST_CASE("bulk load duplicates", "[bulk_load][find]") {
+    const std::size_t key_size = 32;
+    const std::size_t val_size = 16;
+    const std::size_t table_size = 1000;
+    const std::size_t thread_count = GENERATE(1, 3);
+    const lockfree_hashtable_config_t config = {
+        table_size,
+        key_size,
+        val_size
+    };
+
+    std::mt19937 generator{std::random_device{}()};
+    std::string find;
+    find.resize(val_size, ' ');
+
+    std::unique_ptr<std::uint8_t[]> memory(new std::uint8_t[lockfree_hashtable_calc_mem_size(&config)]);
+
+    lockfree_hashtable_t table;
+    lockfree_hashtable_init(&table, &config, memory.get());
+
+    // every key is repeated three times with different values
+    const auto unique = generate_random_data(table_size / 4, key_size, val_size, generator);
+    std::vector<std::pair<std::string, std::string>> random_data;
+    for (std::size_t copy = 0; copy < 3; ++copy) {
+        for (auto& [key, val]: unique) {
+            random_data.emplace_back(key, random_string(std::to_string(copy), val_size, generator));
+        }
+    }
+    const auto data = pack_pairs(random_data);
+
+    SECTION("keep last") {
+        REQUIRE(lockfree_hashtable_bulk_load(&table, data.data(), random_data.size(), LOCKFREE_HASHTABLE_BULK_KEEP_LAST, thread_count));
+        for (std::size_t i = 0; i < unique.size(); ++i) {
+            REQUIRE(lockfree_hashtable_find(&table, unique[i].first.data(), find.data()));
+            REQUIRE(find == random_data[2 * unique.size() + i].second);
+        }
+    }
+
+    SECTION("keep first") {
+        REQUIRE(lockfree_hashtable_bulk_load(&table, data.data(), random_data.size(), LOCKFREE_HASHTABLE_BULK_KEEP_FIRST, thread_count));
+        for (std::size_t i = 0; i < unique.size(); ++i) {
+            REQUIRE(lockfree_hashtable_find(&table, unique[i].first.data(), find.data()));
+            REQUIRE(find == random_data[i].second);
+        }
+    }
+
+    SECTION("fail") {
+        REQUIRE(!lockfree_hashtable_bulk_load(&table, data.data(), random_data.size(), LOCKFREE_HASHTABLE_BULK_FAIL, thread_count));
+    }
+
+    SECTION("dropped records are free") {
+        REQUIRE(lockfree_hashtable_bulk_load(&table, data.data(), random_data.size(), LOCKFREE_HASHTABLE_BULK_KEEP_LAST, thread_count));
+        for (std::size_t i = 0; i < table_size - unique.size(); ++i) {
+            const auto key = random_string("key_" + std::to_string(i) + "_", key_size, generator);
+            const auto val = random_string("val1", val_size, generator);
+            REQUIRE(lockfree_hashtable_insert(&table, key.data(), val.data()));
+        }
+        const auto key = random_string("key_last", key_size, generator);
+        const auto val = random_string("val1", val_size, generator);
+        REQUIRE(!lockfree_hashtable_insert(&table, key.data(), val.data()));
+    }
+}
@@ -0,0 +1,160 @@
+#include <memory>
+#include <vector>
+#include <future>
+#include <map>
+
+#include <catch2/catch_all.hpp>
+#include <lockfree-hashtable.h>
+#include "misc.hpp"
+
+TEST_CASE("change feed", "[changefeed][insert][erase]") {
+    const std::size_t key_size = 64;
+    const std::size_t val_size = 128;
+    const std::size_t table_size = 1000;
+    const std::size_t changefeed_size = GENERATE(1, 16, 1024);
+    const lockfree_hashtable_config_t config = {
+        table_size,
+        key_size,
+        val_size,
+        0,
+        changefeed_size
+    };
+
+    std::mt19937 generator{std::random_device{}()};
+    const auto random_data = generate_random_data(8, key_size, val_size, generator);
+    std::string key;
+    key.resize(key_size, ' ');
+    std::string val;
+    val.resize(val_size, ' ');
+
+    std::unique_ptr<std::uint8_t[]> memory(new std::uint8_t[lockfree_hashtable_calc_mem_size(&config)]);
+
+    lockfree_hashtable_t table;
+    lockfree_hashtable_init(&table, &config, memory.get());
+
+    std::uint64_t cursor = lockfree_hashtable_changefeed_position(&table);
+    lockfree_hashtable_event_t event;
+    REQUIRE(lockfree_hashtable_changefeed_read(&table, &cursor, &event, key.data(), val.data()) == LOCKFREE_HASHTABLE_CHANGEFEED_EMPTY);
+
+    SECTION("read every change") {
+        auto& [key1, val1] = random_data[0];
+        auto& [key2, val2] = random_data[1];
+
+        REQUIRE(lockfree_hashtable_insert(&table, key1.data(), val1.data()));
+        REQUIRE(lockfree_hashtable_changefeed_read(&table, &cursor, &event, key.data(), val.data()) == LOCKFREE_HASHTABLE_CHANGEFEED_EVENT);
+        REQUIRE(event.type == LOCKFREE_HASHTABLE_EVENT_INSERT);
+        REQUIRE(key == key1);
+        REQUIRE(val == val1);
+
+        REQUIRE(lockfree_hashtable_insert(&table, key1.data(), val2.data()));
+        REQUIRE(lockfree_hashtable_changefeed_read(&table, &cursor, &event, key.data(), val.data()) == LOCKFREE_HASHTABLE_CHANGEFEED_EVENT);
+        REQUIRE(event.type == LOCKFREE_HASHTABLE_EVENT_OVERWRITE);
+        REQUIRE(key == key1);
+        REQUIRE(val == val2);
+
+        REQUIRE(lockfree_hashtable_erase(&table, key1.data()));
+        REQUIRE(lockfree_hashtable_changefeed_read(&table, &cursor, &event, key.data(), val.data()) == LOCKFREE_HASHTABLE_CHANGEFEED_EVENT);
+        REQUIRE(event.type == LOCKFREE_HASHTABLE_EVENT_ERASE);
+        REQUIRE(key == key1);
+
+        REQUIRE(!lockfree_hashtable_erase(&table, key2.data()));
+        REQUIRE(lockfree_hashtable_changefeed_read(&table, &cursor, &event, key.data(), val.data()) == LOCKFREE_HASHTABLE_CHANGEFEED_EMPTY);
+    }
+
+    SECTION("several readers") {
+        std::uint64_t other = cursor;
+        for (auto& [key, val]: random_data) {
+            REQUIRE(lockfree_hashtable_insert(&table, key.data(), val.data()));
+        }
+        if (changefeed_size < random_data.size()) {
+            REQUIRE(lockfree_hashtable_changefeed_read(&table, &cursor, &event, key.data(), val.data()) == LOCKFREE_HASHTABLE_CHANGEFEED_OVERRUN);
+            REQUIRE(lockfree_hashtable_changefeed_read(&table, &other, &event, key.data(), val.data()) == LOCKFREE_HASHTABLE_CHANGEFEED_OVERRUN);
+        } else {
+            for (auto& [k, v]: random_data) {
+                REQUIRE(lockfree_hashtable_changefeed_read(&table, &cursor, &event, key.data(), val.data()) == LOCKFREE_HASHTABLE_CHANGEFEED_EVENT);
+                REQUIRE(key == k);
+                REQUIRE(val == v);
+            }
+            REQUIRE(lockfree_hashtable_changefeed_read(&table, &other, &event, key.data(), val.data()) == LOCKFREE_HASHTABLE_CHANGEFEED_EVENT);
+            REQUIRE(key == random_data[0].first);
+            REQUIRE(lockfree_hashtable_changefeed_read(&table, &cursor, &event, key.data(), val.data()) == LOCKFREE_HASHTABLE_CHANGEFEED_EMPTY);
+        }
+    }
+}
+
+TEST_CASE("concurrent change feed replica", "[changefeed][insert][erase]") {
+    const std::size_t key_size = 16;
+    const std::size_t val_size = 16;
+    const std::size_t table_size = 10'000;
+    const std::size_t thread_count = GENERATE(2, 7);
+    const std::size_t operations = 10'000;
+    const lockfree_hashtable_config_t config = {
+        table_size,
+        key_size,
+        val_size,
+        0,
+        2 * thread_count * operations
+    };
+
+    std::mt19937 generator{std::random_device{}()};
+    const auto random_data = generate_random_data(100, key_size, val_size, generator);
+
+    std::unique_ptr<std::uint8_t[]> memory(new std::uint8_t[lockfree_hashtable_calc_mem_size(&config)]);
+
+    lockfree_hashtable_t table;
+    lockfree_hashtable_init(&table, &config, memory.get());
+    std::uint64_t cursor = lockfree_hashtable_changefeed_position(&table);
+
+    // contended inserts and overwrites of a few keys from several threads, then contended erases
+    auto modify = [&] (std::random_device::result_type seed, bool erase) {
+        std::mt19937 generator{seed};
+        std::uniform_int_distribution<std::size_t> pick(0, random_data.size() - 1);
+        for (std::size_t i = 0; i < operations; ++i) {
+            auto& [key, val] = random_data[pick(generator)];
+            if (erase) {
+                lockfree_hashtable_erase(&table, key.data());
+            } else {
+                auto value = val;
+                value[0] = 'a' + i % 26;
+                lockfree_hashtable_insert(&table, key.data(), value.data());
+            }
+        }
+    };
+    for (bool erase: {false, true}) {
+        std::vector<std::future<void>> threads;
+        for (std::size_t i = 0; i < thread_count; ++i) {
+            threads.emplace_back(std::async(std::launch::async, modify, generator(), erase));
+        }
+        for (auto& th: threads) {
+            th.get();
+        }
+    }
+
+    // replay the change feed and compare with the table
+    std::map<std::string, std::string> replica;
+    std::string key;
+    key.resize(key_size, ' ');
+    std::string val;
+    val.resize(val_size, ' ');
+    lockfree_hashtable_event_t event;
+    lockfree_hashtable_changefeed_status_t status;
+    while ((status = lockfree_hashtable_changefeed_read(&table, &cursor, &event, key.data(), val.data())) == LOCKFREE_HASHTABLE_CHANGEFEED_EVENT) {
+        if (event.type == LOCKFREE_HASHTABLE_EVENT_ERASE) {
+            REQUIRE(replica.erase(key) == 1);
+        } else {
+            REQUIRE((event.type == LOCKFREE_HASHTABLE_EVENT_INSERT) == (replica.count(key) == 0));
+            replica[key] = val;
+        }
+    }
+    REQUIRE(status == LOCKFREE_HASHTABLE_CHANGEFEED_EMPTY);
+
+    for (auto& [key, val]: random_data) {
+        auto it = replica.find(key);
+        std::string find;
+        find.resize(val_size, ' ');
+        REQUIRE(lockfree_hashtable_find(&table, key.data(), find.data()) == (it != replica.end()));
+        if (it != replica.end()) {
+            REQUIRE(find == it->second);
+        }
+    }
+}
@@ -0,0 +1,268 @@
+#include <memory>
+#include <vector>
+#include <future>
+#include <atomic>
+#include <thread>
+#include <algorithm>
+#include <cstring>
+
+#include <catch2/catch_all.hpp>
+#include <lockfree-hashtable.h>
+#include "misc.hpp"
+
+TEST_CASE("clear", "[clear][insert][find][erase]") {
+    const std::size_t key_size = 64;
+    const std::size_t val_size = 16;
+    const std::size_t table_size = 1'000;
+    const unsigned flags = GENERATE(
+        LOCKFREE_HASHTABLE_CLEARABLE,
+        LOCKFREE_HASHTABLE_CLEARABLE | LOCKFREE_HASHTABLE_HASHED_KEYS,
+        LOCKFREE_HASHTABLE_CLEARABLE | LOCKFREE_HASHTABLE_ORDERED_INDEX
+    );
+    lockfree_hashtable_config_t config = {
+        table_size,
+        key_size,
+        val_size,
+        flags
+    };
+    config.filter_size = 1024;
+
+    std::mt19937 generator{std::random_device{}()};
+    const auto random_data = generate_random_data(table_size, key_size, val_size, generator);
+    std::string find;
+    find.resize(val_size, ' ');
+
+    std::unique_ptr<std::uint8_t[]> memory(new std::uint8_t[lockfree_hashtable_calc_mem_size(&config)]);
+
+    lockfree_hashtable_t table;
+    lockfree_hashtable_init(&table, &config, memory.get());
+    REQUIRE(lockfree_hashtable_clear(&table));
+
+    SECTION("cleared pairs are gone and the table can be filled again") {
+        for (std::size_t round = 0; round < 3; ++round) {
+            for (auto& [key, val]: random_data) {
+                REQUIRE(lockfree_hashtable_insert(&table, key.data(), val.data()));
+            }
+            for (auto& [key, val]: random_data) {
+                REQUIRE(lockfree_hashtable_find(&table, key.data(), find.data()));
+                REQUIRE(find == val);
+            }
+            REQUIRE(lockfree_hashtable_clear(&table));
+            for (auto& [key, val]: random_data) {
+                REQUIRE(!lockfree_hashtable_find(&table, key.data(), nullptr));
+                REQUIRE(!lockfree_hashtable_erase(&table, key.data()));
+            }
+        }
+    }
+
+    SECTION("insert after clear") {
+        for (std::size_t i = 0; i < random_data.size() / 2; ++i) {
+            REQUIRE(lockfree_hashtable_insert(&table, random_data[i].first.data(), random_data[i].second.data()));
+        }
+        REQUIRE(lockfree_hashtable_clear(&table));
+        // keys of the first half are new again, keys of the second half were never there
+        for (std::size_t i = 0; i < random_data.size(); i += 2) {
+            REQUIRE(lockfree_hashtable_insert(&table, random_data[i].first.data(), random_data[i].second.data()));
+        }
+        for (std::size_t i = 0; i < random_data.size(); ++i) {
+            auto& [key, val] = random_data[i];
+            if (i % 2 == 0) {
+                REQUIRE(lockfree_hashtable_find(&table, key.data(), find.data()));
+                REQUIRE(find == val);
+            } else {
+                REQUIRE(!lockfree_hashtable_find(&table, key.data(), nullptr));
+            }
+        }
+        for (std::size_t i = 0; i < random_data.size(); i += 4) {
+            REQUIRE(lockfree_hashtable_erase(&table, random_data[i].first.data()));
+            REQUIRE(!lockfree_hashtable_find(&table, random_data[i].first.data(), nullptr));
+        }
+    }
+
+    SECTION("freeze skips cleared pairs") {
+        for (std::size_t i = 0; i < random_data.size() / 2; ++i) {
+            REQUIRE(lockfree_hashtable_insert(&table, random_data[i].first.data(), random_data[i].second.data()));
+        }
+        REQUIRE(lockfree_hashtable_clear(&table));
+        auto& [key, val] = random_data.back();
+        REQUIRE(lockfree_hashtable_insert(&table, key.data(), val.data()));
+
+        const auto size = lockfree_hashtable_freeze_calc_mem_size(&table);
+        std::vector<std::uint64_t> snapshot(size / sizeof(std::uint64_t));
+        REQUIRE(lockfree_hashtable_freeze(&table, snapshot.data(), size) == size);
+
+        lockfree_hashtable_frozen_t frozen;
+        REQUIRE(lockfree_hashtable_frozen_open(&frozen, snapshot.data(), size));
+        REQUIRE(lockfree_hashtable_frozen_find(&frozen, key.data(), find.data()));
+        REQUIRE(find == val);
+        REQUIRE(!lockfree_hashtable_frozen_find(&frozen, random_data[0].first.data(), nullptr));
+    }
+
+    SECTION("concurrent clears, inserts and finds") {
+        std::atomic_bool done = false;
+        // every thread inserts its own keys of the first half and finds them until the next clear,
+        // the second half of the table is left for overwrites
+        auto insert_and_find = [&] (std::size_t first, std::size_t step) {
+            for (std::size_t round = 0; round < 20; ++round) {
+                for (std::size_t i = first; i < random_data.size() / 2; i += step) {
+                    auto& [key, val] = random_data[i];
+                    if (!lockfree_hashtable_insert(&table, key.data(), val.data())) {
+                        return false;
+                    }
+                    std::string find;
+                    find.resize(val_size, ' ');
+                    if (lockfree_hashtable_find(&table, key.data(), find.data()) && find != val) {
+                        return false;
+                    }
+                }
+            }
+            return true;
+        };
+        auto clear = [&] {
+            while (!done) {
+                lockfree_hashtable_clear(&table);
+                std::this_thread::yield();
+            }
+        };
+        auto clearer = std::async(std::launch::async, clear);
+        std::vector<std::future<bool>> threads;
+        for (std::size_t i = 0; i < 4; ++i) {
+            threads.emplace_back(std::async(std::launch::async, insert_and_find, i, 4));
+        }
+        std::vector<bool> results;
+        for (auto& th: threads) {
+            results.push_back(th.get());
+        }
+        done = true;
+        clearer.get();
+        REQUIRE(std::find(results.begin(), results.end(), false) == results.end());
+
+        REQUIRE(lockfree_hashtable_clear(&table));
+        for (auto& [key, val]: random_data) {
+            REQUIRE(!lockfree_hashtable_find(&table, key.data(), nullptr));
+        }
+        for (auto& [key, val]: random_data) {
+            REQUIRE(lockfree_hashtable_insert(&table, key.data(), val.data()));
+        }
+    }
+}
+
+TEST_CASE("clear in change feed", "[clear][changefeed]") {
+    lockfree_hashtable_config_t config = {
+        100,
+        64,
+        16,
+        LOCKFREE_HASHTABLE_CLEARABLE,
+        16
+    };
+    std::mt19937 generator{std::random_device{}()};
+    const auto random_data = generate_random_data(2, config.key_size, config.val_size, generator);
+    std::string key;
+    key.resize(config.key_size, ' ');
+    std::string val;
+    val.resize(config.val_size, ' ');
+
+    std::unique_ptr<std::uint8_t[]> memory(new std::uint8_t[lockfree_hashtable_calc_mem_size(&config)]);
+
+    lockfree_hashtable_t table;
+    lockfree_hashtable_init(&table, &config, memory.get());
+
+    std::uint64_t cursor = lockfree_hashtable_changefeed_position(&table);
+    lockfree_hashtable_event_t event;
+
+    REQUIRE(lockfree_hashtable_insert(&table, random_data[0].first.data(), random_data[0].second.data()));
+    REQUIRE(lockfree_hashtable_clear(&table));
+    REQUIRE(lockfree_hashtable_insert(&table, random_data[1].first.data(), random_data[1].second.data()));
+
+    REQUIRE(lockfree_hashtable_changefeed_read(&table, &cursor, &event, key.data(), val.data()) == LOCKFREE_HASHTABLE_CHANGEFEED_EVENT);
+    REQUIRE(event.type == LOCKFREE_HASHTABLE_EVENT_INSERT);
+    REQUIRE(key == random_data[0].first);
+    REQUIRE(lockfree_hashtable_changefeed_read(&table, &cursor, &event, key.data(), val.data()) == LOCKFREE_HASHTABLE_CHANGEFEED_EVENT);
+    REQUIRE(event.type == LOCKFREE_HASHTABLE_EVENT_CLEAR);
+    REQUIRE(key == random_data[0].first);
+    REQUIRE(lockfree_hashtable_changefeed_read(&table, &cursor, &event, key.data(), val.data()) == LOCKFREE_HASHTABLE_CHANGEFEED_EVENT);
+    REQUIRE(event.type == LOCKFREE_HASHTABLE_EVENT_INSERT);
+    REQUIRE(key == random_data[1].first);
+    REQUIRE(lockfree_hashtable_changefeed_read(&table, &cursor, &event, key.data(), val.data()) == LOCKFREE_HASHTABLE_CHANGEFEED_EMPTY);
+}
+
+// counts compared keys of a table in one thread
+static std::size_t compared_keys = 0;
+
+static bool counting_equal(const void* key1, const void* key2, std::size_t key_size)
+{
+    compared_keys += 1;
+    return std::memcmp(key1, key2, key_size) == 0;
+}
+
+TEST_CASE("lookups after repeated clears", "[clear][find]") {
+    const lockfree_hashtable_config_t config = {
+        20'000,
+        64,
+        16,
+        LOCKFREE_HASHTABLE_CLEARABLE
+    };
+    std::mt19937 generator{std::random_device{}()};
+    std::vector<std::string> absent_keys;
+    for (std::size_t i = 0; i < 10'000; ++i) {
+        absent_keys.push_back(random_string("absent_", config.key_size, generator));
+    }
+
+    std::unique_ptr<std::uint8_t[]> memory(new std::uint8_t[lockfree_hashtable_calc_mem_size(&config)]);
+    std::unique_ptr<std::uint8_t[]> new_memory(new std::uint8_t[lockfree_hashtable_calc_mem_size(&config)]);
+
+    lockfree_hashtable_t table;
+    lockfree_hashtable_init(&table, &config, memory.get());
+    table.key_equal = counting_equal;
+
+    // keys compared by finds of absent keys
+    auto miss_compares = [&] (lockfree_hashtable_t* table) {
+        compared_keys = 0;
+        for (auto& key: absent_keys) {
+            REQUIRE(!lockfree_hashtable_find(table, key.data(), nullptr));
+        }
+        return compared_keys;
+    };
+
+    // entries of older epochs are free, so a refilled table has the same slots and probes as a new table with the same pairs
+    for (std::size_t round = 0; round < 8; ++round) {
+        lockfree_hashtable_t new_table;
+        lockfree_hashtable_init(&new_table, &config, new_memory.get());
+        new_table.key_equal = counting_equal;
+
+        const auto random_data = generate_random_data(16'000, config.key_size, config.val_size, generator);
+        for (auto& [key, val]: random_data) {
+            lockfree_hashtable_slot_t slot;
+            lockfree_hashtable_slot_t new_slot;
+            REQUIRE(lockfree_hashtable_insert_slot(&table, key.data(), val.data(), &slot));
+            REQUIRE(lockfree_hashtable_insert_slot(&new_table, key.data(), val.data(), &new_slot));
+            REQUIRE(slot.index == new_slot.index);
+        }
+        REQUIRE(miss_compares(&table) == miss_compares(&new_table));
+        for (auto& [key, val]: random_data) {
+            REQUIRE(lockfree_hashtable_find(&table, key.data(), nullptr));
+        }
+        REQUIRE(lockfree_hashtable_clear(&table));
+    }
+}
+
+TEST_CASE("table without clear", "[clear]") {
+    const lockfree_hashtable_config_t config = {
+        100,
+        64,
+        16
+    };
+    std::mt19937 generator{std::random_device{}()};
+    const auto random_data = generate_random_data(1, config.key_size, config.val_size, generator);
+
+    std::unique_ptr<std::uint8_t[]> memory(new std::uint8_t[lockfree_hashtable_calc_mem_size(&config)]);
+
+    lockfree_hashtable_t table;
+    lockfree_hashtable_init(&table, &config, memory.get());
+    REQUIRE(table.clear == nullptr);
+
+    auto& [key, val] = random_data[0];
+    REQUIRE(lockfree_hashtable_insert(&table, key.data(), val.data()));
+    REQUIRE(!lockfree_hashtable_clear(&table));
+    REQUIRE(lockfree_hashtable_find(&table, key.data(), nullptr));
+}
@@ -0,0 +1,129 @@
+#include <memory>
+#include <vector>
+#include <future>
+#include <set>
+
+#include <catch2/catch_all.hpp>
+#include <lockfree-hashtable.h>
+#include "misc.hpp"
+
+struct expired_t {
+    const lockfree_hashtable_config_t* config;
+    std::set<std::string> vals;
+};
+
+// erase pairs with values from the set, values are compared because keys may be hashed
+static bool is_expired(const void* key, const void* val, void* context)
+{
+    auto* expired = static_cast<expired_t*>(context);
+    return expired->vals.count(std::string(static_cast<const char*>(val), expired->config->val_size)) != 0;
+}
+
+TEST_CASE("erase if", "[erase_if][insert][find]") {
+    const std::size_t key_size = 64;
+    const std::size_t val_size = 16;
+    const std::size_t table_size = 5'000;
+    const std::size_t thread_count = GENERATE(1, 4);
+    const unsigned flags = GENERATE(0u, LOCKFREE_HASHTABLE_HASHED_KEYS, LOCKFREE_HASHTABLE_ORDERED_INDEX | LOCKFREE_HASHTABLE_MAGAZINES);
+    lockfree_hashtable_config_t config = {
+        table_size,
+        key_size,
+        val_size,
+        flags
+    };
+    config.filter_size = 4 * table_size;
+
+    std::mt19937 generator{std::random_device{}()};
+    const auto random_data = generate_random_data(table_size / 2, key_size, val_size, generator);
+    std::string find;
+    find.resize(val_size, ' ');
+
+    std::unique_ptr<std::uint8_t[]> memory(new std::uint8_t[lockfree_hashtable_calc_mem_size(&config)]);
+
+    lockfree_hashtable_t table;
+    lockfree_hashtable_init(&table, &config, memory.get());
+
+    expired_t expired{table.config, {}};
+    for (std::size_t i = 0; i < random_data.size(); i += 3) {
+        expired.vals.insert(random_data[i].second);
+    }
+    REQUIRE(lockfree_hashtable_erase_if(&table, is_expired, &expired, thread_count) == 0);
+
+    SECTION("erase matching pairs") {
+        for (auto& [key, val]: random_data) {
+            REQUIRE(lockfree_hashtable_insert(&table, key.data(), val.data()));
+        }
+        REQUIRE(lockfree_hashtable_erase_if(&table, is_expired, &expired, thread_count) == expired.vals.size());
+        for (std::size_t i = 0; i < random_data.size(); ++i) {
+            auto& [key, val] = random_data[i];
+            if (i % 3 == 0) {
+                REQUIRE(!lockfree_hashtable_find(&table, key.data(), nullptr));
+            } else {
+                REQUIRE(lockfree_hashtable_find(&table, key.data(), find.data()));
+                REQUIRE(find == val);
+            }
+        }
+        REQUIRE(lockfree_hashtable_erase_if(&table, is_expired, &expired, thread_count) == 0);
+
+        if (table.index) {
+            auto count = [] (const void*, const void*, void*) {
+                return true;
+            };
+            REQUIRE(lockfree_hashtable_range(&table, nullptr, nullptr, count, nullptr) == random_data.size() - expired.vals.size());
+        }
+
+        // erased records are free
+        for (std::size_t i = 0; i < random_data.size(); i += 3) {
+            REQUIRE(lockfree_hashtable_insert(&table, random_data[i].first.data(), random_data[i].second.data()));
+        }
+        expired.vals.clear();
+        for (auto& [key, val]: random_data) {
+            expired.vals.insert(val);
+        }
+        REQUIRE(lockfree_hashtable_erase_if(&table, is_expired, &expired, thread_count) == random_data.size());
+        for (auto& [key, val]: random_data) {
+            REQUIRE(!lockfree_hashtable_find(&table, key.data(), nullptr));
+        }
+    }
+
+    SECTION("erase during inserts") {
+        for (std::size_t i = 0; i < random_data.size(); i += 3) {
+            REQUIRE(lockfree_hashtable_insert(&table, random_data[i].first.data(), random_data[i].second.data()));
+        }
+        // other keys are inserted while the expired ones are erased
+        auto insert = [&] (std::size_t first, std::size_t step) {
+            for (std::size_t i = first; i < random_data.size(); i += step) {
+                if (i % 3 == 0) {
+                    continue;
+                }
+                auto& [key, val] = random_data[i];
+                if (!lockfree_hashtable_insert(&table, key.data(), val.data())) {
+                    return false;
+                }
+            }
+            return true;
+        };
+        std::vector<std::future<bool>> threads;
+        for (std::size_t i = 0; i < 2; ++i) {
+            threads.emplace_back(std::async(std::launch::async, insert, i, 2));
+        }
+        const auto erased = lockfree_hashtable_erase_if(&table, is_expired, &expired, thread_count);
+        for (auto& th: threads) {
+            REQUIRE(th.get());
+        }
+        REQUIRE(erased == expired.vals.size());
+        for (std::size_t i = 0; i < random_data.size(); ++i) {
+            auto& [key, val] = random_data[i];
+            REQUIRE(lockfree_hashtable_find(&table, key.data(), nullptr) == (i % 3 != 0));
+        }
+
+        // records erased by the sweeping threads are free, also the ones cached in magazines of threads which exited
+        const auto kept = random_data.size() - expired.vals.size();
+        const auto new_data = generate_random_data(table_size - kept, key_size, val_size, generator);
+        for (auto& [key, val]: new_data) {
+            REQUIRE(lockfree_hashtable_insert(&table, key.data(), val.data()));
+        }
+        const auto key = random_string("key_1", key_size, generator);
+        REQUIRE(!lockfree_hashtable_insert(&table, key.data(), random_data[0].second.data()));
+    }
+}
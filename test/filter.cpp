@@ -0,0 +1,120 @@
+#include <memory>
+#include <vector>
+#include <future>
+
+#include <catch2/catch_all.hpp>
+#include <lockfree-hashtable.h>
+#include "misc.hpp"
+
+TEST_CASE("filter of absent keys", "[filter][insert][find][erase]") {
+    const std::size_t key_size = GENERATE(8, 64);
+    const std::size_t val_size = 16;
+    const std::size_t table_size = 10'000;
+    const unsigned flags = GENERATE(0u, LOCKFREE_HASHTABLE_HASHED_KEYS);
+    const lockfree_hashtable_config_t config = {
+        table_size,
+        key_size,
+        val_size,
+        flags,
+        0,
+        table_size * 4
+    };
+
+    std::mt19937 generator{std::random_device{}()};
+    const auto random_data = generate_random_data(table_size, key_size, val_size, generator);
+    // keys of the table start with a number
+    auto absent_data = generate_random_data(table_size, key_size, val_size, generator);
+    for (auto& [key, val]: absent_data) {
+        key[0] = 'x';
+    }
+    std::string find;
+    find.resize(val_size, ' ');
+
+    std::unique_ptr<std::uint8_t[]> memory(new std::uint8_t[lockfree_hashtable_calc_mem_size(&config)]);
+
+    lockfree_hashtable_t table;
+    lockfree_hashtable_init(&table, &config, memory.get());
+
+    auto false_positives = [&] {
+        std::size_t count = 0;
+        for (auto& [key, val]: absent_data) {
+            REQUIRE(!lockfree_hashtable_find(&table, key.data(), nullptr));
+            count += lockfree_hashtable_may_contain(&table, key.data());
+        }
+        return count;
+    };
+    REQUIRE(false_positives() == 0);
+
+    SECTION("insert and erase") {
+        for (auto& [key, val]: random_data) {
+            REQUIRE(lockfree_hashtable_insert(&table, key.data(), val.data()));
+            REQUIRE(lockfree_hashtable_may_contain(&table, key.data()));
+        }
+        REQUIRE(false_positives() < absent_data.size() / 20);
+        for (auto& [key, val]: random_data) {
+            REQUIRE(lockfree_hashtable_find(&table, key.data(), find.data()));
+            REQUIRE(find == val);
+        }
+
+        for (std::size_t i = 0; i < random_data.size(); i += 2) {
+            REQUIRE(lockfree_hashtable_erase(&table, random_data[i].first.data()));
+        }
+        for (std::size_t i = 1; i < random_data.size(); i += 2) {
+            REQUIRE(lockfree_hashtable_find(&table, random_data[i].first.data(), find.data()));
+            REQUIRE(find == random_data[i].second);
+        }
+        for (std::size_t i = 1; i < random_data.size(); i += 2) {
+            REQUIRE(lockfree_hashtable_erase(&table, random_data[i].first.data()));
+        }
+        // only saturated counters are left
+        REQUIRE(false_positives() < absent_data.size() / 1000);
+    }
+
+    SECTION("overwrite") {
+        for (std::size_t round = 0; round < 3; ++round) {
+            for (std::size_t i = 0; i < random_data.size() / 2; ++i) {
+                REQUIRE(lockfree_hashtable_insert(&table, random_data[i].first.data(), random_data[i].second.data()));
+            }
+        }
+        for (std::size_t i = 0; i < random_data.size() / 2; ++i) {
+            REQUIRE(lockfree_hashtable_erase(&table, random_data[i].first.data()));
+        }
+        REQUIRE(false_positives() < absent_data.size() / 1000);
+    }
+
+    SECTION("bulk load") {
+        std::vector<std::uint8_t> data;
+        for (auto& [key, val]: random_data) {
+            data.insert(data.end(), key.begin(), key.end());
+            data.insert(data.end(), val.begin(), val.end());
+        }
+        REQUIRE(lockfree_hashtable_bulk_load(&table, data.data(), random_data.size(), LOCKFREE_HASHTABLE_BULK_FAIL, 3));
+        for (auto& [key, val]: random_data) {
+            REQUIRE(lockfree_hashtable_find(&table, key.data(), find.data()));
+            REQUIRE(find == val);
+        }
+        for (auto& [key, val]: random_data) {
+            REQUIRE(lockfree_hashtable_erase(&table, key.data()));
+        }
+        REQUIRE(false_positives() < absent_data.size() / 1000);
+    }
+
+    SECTION("concurrent inserts and finds") {
+        auto insert_and_find = [&] (std::size_t first, std::size_t step) {
+            for (std::size_t i = first; i < random_data.size(); i += step) {
+                auto& [key, val] = random_data[i];
+                if (!lockfree_hashtable_insert(&table, key.data(), val.data()) || !lockfree_hashtable_find(&table, key.data(), nullptr)) {
+                    return false;
+                }
+            }
+            return true;
+        };
+        std::vector<std::future<bool>> threads;
+        for (std::size_t i = 0; i < 4; ++i) {
+            threads.emplace_back(std::async(std::launch::async, insert_and_find, i, 4));
+        }
+        for (auto& th: threads) {
+            REQUIRE(th.get());
+        }
+    }
+}
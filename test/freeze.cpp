@@ -0,0 +1,76 @@
+#include <memory>
+#include <vector>
+
+#include <catch2/catch_all.hpp>
+#include <lockfree-hashtable.h>
+#include "misc.hpp"
+
+TEST_CASE("freeze table", "[freeze][find]") {
+    const std::size_t key_size = GENERATE(5, 64);
+    const std::size_t val_size = GENERATE(7, 128);
+    const std::size_t table_size = GENERATE(1, 17, 1000);
+    const lockfree_hashtable_config_t config = {
+        table_size,
+        key_size,
+        val_size
+    };
+
+    std::mt19937 generator{std::random_device{}()};
+    const auto random_data = generate_random_data(table_size, key_size, val_size, generator);
+    std::string find;
+    find.resize(val_size, ' ');
+
+    std::unique_ptr<std::uint8_t[]> memory(new std::uint8_t[lockfree_hashtable_calc_mem_size(&config)]);
+
+    lockfree_hashtable_t table;
+    lockfree_hashtable_init(&table, &config, memory.get());
+
+    for (auto& [key, val]: random_data) {
+        REQUIRE(lockfree_hashtable_insert(&table, key.data(), val.data()));
+    }
+    // erase every third pair to leave deleted entries behind
+    for (std::size_t i = 0; i < random_data.size(); i += 3) {
+        REQUIRE(lockfree_hashtable_erase(&table, random_data[i].first.data()));
+    }
+
+    const auto size = lockfree_hashtable_freeze_calc_mem_size(&table);
+    std::vector<std::uint64_t> snapshot(size / sizeof(std::uint64_t));
+    REQUIRE(lockfree_hashtable_freeze(&table, snapshot.data(), size) == size);
+
+    auto check = [&] (const void* memory, std::size_t size) {
+        lockfree_hashtable_frozen_t frozen;
+        REQUIRE(lockfree_hashtable_frozen_open(&frozen, memory, size));
+        for (std::size_t i = 0; i < random_data.size(); ++i) {
+            auto& [key, val] = random_data[i];
+            if (i % 3 == 0) {
+                REQUIRE(!lockfree_hashtable_frozen_find(&frozen, key.data(), nullptr));
+            } else {
+                REQUIRE(lockfree_hashtable_frozen_find(&frozen, key.data(), find.data()));
+                REQUIRE(find == val);
+            }
+        }
+        const auto key = random_string("key_1", key_size, generator);
+        REQUIRE(!lockfree_hashtable_frozen_find(&frozen, key.data(), nullptr));
+    };
+
+    SECTION("find in snapshot") {
+        check(snapshot.data(), size);
+    }
+
+    SECTION("find in moved snapshot") {
+        std::vector<std::uint64_t> copy(snapshot);
+        snapshot.assign(snapshot.size(), 0);
+        check(copy.data(), size);
+    }
+
+    SECTION("small buffer") {
+        REQUIRE(lockfree_hashtable_freeze(&table, snapshot.data(), size - 1) == 0);
+    }
+
+    SECTION("broken snapshot") {
+        lockfree_hashtable_frozen_t frozen;
+        REQUIRE(!lockfree_hashtable_frozen_open(&frozen, snapshot.data(), size - 1));
+        snapshot[0] = 0;
+        REQUIRE(!lockfree_hashtable_frozen_open(&frozen, snapshot.data(), size));
+    }
+}
@@ -0,0 +1,105 @@
+#include <memory>
+#include <vector>
+
+#include <catch2/catch_all.hpp>
+#include <lockfree-hashtable.h>
+#include "misc.hpp"
+
+TEST_CASE("hashed keys", "[insert][find][erase]") {
+    const std::size_t key_size = GENERATE(5, 16, 64);
+    const std::size_t val_size = GENERATE(7, 128);
+    const std::size_t table_size = GENERATE(17, 1000);
+    const lockfree_hashtable_config_t config = {
+        table_size,
+        key_size,
+        val_size,
+        LOCKFREE_HASHTABLE_HASHED_KEYS
+    };
+    const lockfree_hashtable_config_t plain_config = {
+        table_size,
+        key_size,
+        val_size
+    };
+
+    std::mt19937 generator{std::random_device{}()};
+    const auto random_data = generate_random_data(table_size, key_size, val_size, generator);
+    std::string find;
+    find.resize(val_size, ' ');
+
+    const auto mem_size = lockfree_hashtable_calc_mem_size(&config);
+    const auto plain_mem_size = lockfree_hashtable_calc_mem_size(&plain_config);
+    if (key_size > 16) {
+        REQUIRE(mem_size < plain_mem_size);
+    }
+    std::unique_ptr<std::uint8_t[]> memory(new std::uint8_t[mem_size]);
+
+    lockfree_hashtable_t table;
+    lockfree_hashtable_init(&table, &config, memory.get());
+
+    SECTION("insert, find and erase") {
+        for (auto& [key, val]: random_data) {
+            REQUIRE(lockfree_hashtable_insert(&table, key.data(), val.data()));
+        }
+        for (auto& [key, val]: random_data) {
+            REQUIRE(lockfree_hashtable_find(&table, key.data(), find.data()));
+            REQUIRE(find == val);
+        }
+        const auto key = random_string("key_1", key_size, generator);
+        REQUIRE(!lockfree_hashtable_find(&table, key.data(), nullptr));
+
+        for (std::size_t i = 0; i < random_data.size(); i += 2) {
+            REQUIRE(lockfree_hashtable_erase(&table, random_data[i].first.data()));
+        }
+        for (std::size_t i = 0; i < random_data.size(); ++i) {
+            auto& [key, val] = random_data[i];
+            if (i % 2 == 0) {
+                REQUIRE(!lockfree_hashtable_find(&table, key.data(), nullptr));
+            } else {
+                REQUIRE(lockfree_hashtable_find(&table, key.data(), find.data()));
+                REQUIRE(find == val);
+            }
+        }
+
+        SECTION("freeze") {
+            const auto size = lockfree_hashtable_freeze_calc_mem_size(&table);
+            std::vector<std::uint64_t> snapshot(size / sizeof(std::uint64_t));
+            REQUIRE(lockfree_hashtable_freeze(&table, snapshot.data(), size) == size);
+
+            lockfree_hashtable_frozen_t frozen;
+            REQUIRE(lockfree_hashtable_frozen_open(&frozen, snapshot.data(), size));
+            for (std::size_t i = 0; i < random_data.size(); ++i) {
+                auto& [key, val] = random_data[i];
+                if (i % 2 == 0) {
+                    REQUIRE(!lockfree_hashtable_frozen_find(&frozen, key.data(), nullptr));
+                } else {
+                    REQUIRE(lockfree_hashtable_frozen_find(&frozen, key.data(), find.data()));
+                    REQUIRE(find == val);
+                }
+            }
+        }
+    }
+
+    SECTION("overwrite value") {
+        // overwrite needs a free record
+        for (std::size_t i = 0; i + 1 < random_data.size(); ++i) {
+            REQUIRE(lockfree_hashtable_insert(&table, random_data[i].first.data(), random_data[i].second.data()));
+        }
+        const auto val = random_string("val1", val_size, generator);
+        REQUIRE(lockfree_hashtable_insert(&table, random_data[0].first.data(), val.data()));
+        REQUIRE(lockfree_hashtable_find(&table, random_data[0].first.data(), find.data()));
+        REQUIRE(find == val);
+    }
+
+    SECTION("bulk load") {
+        std::vector<std::uint8_t> data;
+        for (auto& [key, val]: random_data) {
+            data.insert(data.end(), key.begin(), key.end());
+            data.insert(data.end(), val.begin(), val.end());
+        }
+        REQUIRE(lockfree_hashtable_bulk_load(&table, data.data(), random_data.size(), LOCKFREE_HASHTABLE_BULK_FAIL, 3));
+        for (auto& [key, val]: random_data) {
+            REQUIRE(lockfree_hashtable_find(&table, key.data(), find.data()));
+            REQUIRE(find == val);
+        }
+    }
+}
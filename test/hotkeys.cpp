@@ -0,0 +1,105 @@
+#include <memory>
+#include <vector>
+#include <future>
+
+#include <catch2/catch_all.hpp>
+#include <lockfree-hashtable.h>
+#include "misc.hpp"
+
+TEST_CASE("hot keys tracker", "[hotkeys][insert][find][erase]") {
+    const std::size_t key_size = 64;
+    const std::size_t val_size = 16;
+    const std::size_t table_size = 1'000;
+    const unsigned flags = GENERATE(0u, LOCKFREE_HASHTABLE_HASHED_KEYS);
+    const std::size_t sampling = GENERATE(1, 10);
+    lockfree_hashtable_config_t config = {
+        table_size,
+        key_size,
+        val_size,
+        flags
+    };
+    config.hotkeys_sampling = sampling;
+
+    std::mt19937 generator{std::random_device{}()};
+    const auto random_data = generate_random_data(table_size - 1, key_size, val_size, generator);
+
+    std::unique_ptr<std::uint8_t[]> memory(new std::uint8_t[lockfree_hashtable_calc_mem_size(&config)]);
+
+    lockfree_hashtable_t table;
+    lockfree_hashtable_init(&table, &config, memory.get());
+
+    lockfree_hashtable_hotkey_t hotkeys[8];
+    REQUIRE(lockfree_hashtable_hotkeys(&table, hotkeys, 8) == 0);
+
+    SECTION("hottest keys go first") {
+        for (auto& [key, val]: random_data) {
+            REQUIRE(lockfree_hashtable_insert(&table, key.data(), val.data()));
+        }
+        const std::size_t hot_finds = 20'000;
+        for (std::size_t i = 0; i < hot_finds; ++i) {
+            REQUIRE(lockfree_hashtable_find(&table, random_data[7].first.data(), nullptr));
+            if (i % 2 == 0) {
+                REQUIRE(lockfree_hashtable_find(&table, random_data[3].first.data(), nullptr));
+            }
+            if (i % 4 == 0) {
+                REQUIRE(lockfree_hashtable_insert(&table, random_data[5].first.data(), random_data[5].second.data()));
+            }
+        }
+        REQUIRE(lockfree_hashtable_hotkeys(&table, hotkeys, 8) == 8);
+        REQUIRE(hotkeys[0].hash == lockfree_hashtable_key_hash(&table, random_data[7].first.data()));
+        REQUIRE(hotkeys[1].hash == lockfree_hashtable_key_hash(&table, random_data[3].first.data()));
+        REQUIRE(hotkeys[2].hash == lockfree_hashtable_key_hash(&table, random_data[5].first.data()));
+        // the sketch may only overestimate
+        REQUIRE(hotkeys[0].count >= hot_finds / sampling * 9 / 10);
+        REQUIRE(hotkeys[0].count < hot_finds / sampling + table_size);
+        for (std::size_t i = 1; i < 8; ++i) {
+            REQUIRE(hotkeys[i - 1].count >= hotkeys[i].count);
+        }
+        REQUIRE(lockfree_hashtable_hotkeys(&table, hotkeys, 1) == 1);
+        REQUIRE(hotkeys[0].hash == lockfree_hashtable_key_hash(&table, random_data[7].first.data()));
+
+        lockfree_hashtable_hotkeys_reset(&table);
+        REQUIRE(lockfree_hashtable_hotkeys(&table, hotkeys, 8) == 0);
+    }
+
+    SECTION("concurrent overwrites") {
+        auto overwrite = [&] (std::size_t count) {
+            for (std::size_t i = 0; i < count; ++i) {
+                auto& [key, val] = random_data[i % 2];
+                if (!lockfree_hashtable_insert(&table, key.data(), val.data())) {
+                    return false;
+                }
+            }
+            return true;
+        };
+        std::vector<std::future<bool>> threads;
+        for (std::size_t i = 0; i < 4; ++i) {
+            threads.emplace_back(std::async(std::launch::async, overwrite, 10'000));
+        }
+        for (auto& th: threads) {
+            REQUIRE(th.get());
+        }
+        REQUIRE(lockfree_hashtable_hotkeys(&table, hotkeys, 8) == 2);
+        const auto hash0 = lockfree_hashtable_key_hash(&table, random_data[0].first.data());
+        const auto hash1 = lockfree_hashtable_key_hash(&table, random_data[1].first.data());
+        REQUIRE((hotkeys[0].hash == hash0 || hotkeys[0].hash == hash1));
+        REQUIRE((hotkeys[1].hash == hash0 || hotkeys[1].hash == hash1));
+        REQUIRE(hotkeys[0].hash != hotkeys[1].hash);
+    }
+}
+
+TEST_CASE("table without hot keys tracker", "[hotkeys]") {
+    const lockfree_hashtable_config_t config = {
+        100,
+        64,
+        16
+    };
+    std::unique_ptr<std::uint8_t[]> memory(new std::uint8_t[lockfree_hashtable_calc_mem_size(&config)]);
+
+    lockfree_hashtable_t table;
+    lockfree_hashtable_init(&table, &config, memory.get());
+    REQUIRE(table.hotkeys == nullptr);
+
+    lockfree_hashtable_hotkey_t hotkeys[1];
+    REQUIRE(lockfree_hashtable_hotkeys(&table, hotkeys, 1) == 0);
+}
@@ -0,0 +1,43 @@
+#include <memory>
+#include <vector>
+
+#include <catch2/catch_all.hpp>
+#include <lockfree-hashtable-compare.h>
+#include "misc.hpp"
+
+TEST_CASE("key compare functions", "[compare]") {
+    const std::size_t key_size = GENERATE(1, 5, 8, 9, 16, 32, 64, 100, 128);
+    const auto isa = GENERATE(
+        LOCKFREE_HASHTABLE_ISA_GENERIC,
+        LOCKFREE_HASHTABLE_ISA_SCALAR,
+        LOCKFREE_HASHTABLE_ISA_SSE2,
+        LOCKFREE_HASHTABLE_ISA_AVX2,
+        LOCKFREE_HASHTABLE_ISA_AVX512
+    );
+
+    std::mt19937 generator{std::random_device{}()};
+    const auto key_equal = lockfree_hashtable_select_key_equal(key_size, isa);
+    REQUIRE(key_equal != nullptr);
+
+    // keys at odd addresses
+    std::vector<std::uint8_t> key1(key_size + 1);
+    std::vector<std::uint8_t> key2(key_size + 3);
+    std::uniform_int_distribution<int> pick(0, 255);
+    for (auto& byte: key1) {
+        byte = pick(generator);
+    }
+    std::memcpy(key2.data() + 3, key1.data() + 1, key_size);
+
+    REQUIRE(key_equal(key1.data() + 1, key2.data() + 3, key_size));
+    for (std::size_t i = 0; i < key_size; ++i) {
+        key2[i + 3] ^= 0x80;
+        REQUIRE(!key_equal(key1.data() + 1, key2.data() + 3, key_size));
+        key2[i + 3] ^= 0x80;
+    }
+
+    // a function chosen for another size compares the whole key
+    const auto other_equal = lockfree_hashtable_select_key_equal(key_size == 64 ? 32 : 64, isa);
+    REQUIRE(other_equal(key1.data() + 1, key2.data() + 3, key_size));
+    key2[key_size + 2] ^= 0x80;
+    REQUIRE(!other_equal(key1.data() + 1, key2.data() + 3, key_size));
+}
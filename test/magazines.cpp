@@ -0,0 +1,208 @@
+#include <memory>
+#include <vector>
+#include <thread>
+#include <atomic>
+
+#include <catch2/catch_all.hpp>
+#include <lockfree-hashtable.h>
+#include "misc.hpp"
+
+// records cached by the magazine of the thread go back to the pool
+struct magazine_guard {
+    lockfree_hashtable_t* table;
+    ~magazine_guard() {
+        lockfree_hashtable_release_magazine(table);
+    }
+};
+
+TEST_CASE("record magazines", "[magazines][insert][find][erase]") {
+    const std::size_t key_size = 64;
+    const std::size_t val_size = 16;
+    const std::size_t table_size = GENERATE(1'000, 4'000);
+    const unsigned flags = GENERATE(
+        LOCKFREE_HASHTABLE_MAGAZINES,
+        LOCKFREE_HASHTABLE_MAGAZINES | LOCKFREE_HASHTABLE_ORDERED_INDEX | LOCKFREE_HASHTABLE_CLEARABLE
+    );
+    const lockfree_hashtable_config_t config = {
+        table_size,
+        key_size,
+        val_size,
+        flags
+    };
+
+    std::mt19937 generator{std::random_device{}()};
+    const auto random_data = generate_random_data(table_size, key_size, val_size, generator);
+    std::string find;
+    find.resize(val_size, ' ');
+
+    std::unique_ptr<std::uint8_t[]> memory(new std::uint8_t[lockfree_hashtable_calc_mem_size(&config)]);
+
+    lockfree_hashtable_t table;
+    lockfree_hashtable_init(&table, &config, memory.get());
+    magazine_guard guard{&table};
+    // records which concurrent inserts may miss while other threads have their magazines
+    const std::size_t reserved = 4 * 64;
+
+    auto fill = [&] {
+        for (auto& [key, val]: random_data) {
+            REQUIRE(lockfree_hashtable_insert(&table, key.data(), val.data()));
+        }
+        for (auto& [key, val]: random_data) {
+            REQUIRE(lockfree_hashtable_find(&table, key.data(), find.data()));
+            REQUIRE(find == val);
+        }
+        const auto key = random_string("key_1", key_size, generator);
+        REQUIRE(!lockfree_hashtable_insert(&table, key.data(), random_data[0].second.data()));
+    };
+
+    SECTION("every record can be used") {
+        for (std::size_t round = 0; round < 3; ++round) {
+            fill();
+            for (auto& [key, val]: random_data) {
+                REQUIRE(lockfree_hashtable_erase(&table, key.data()));
+            }
+        }
+    }
+
+    SECTION("records cached by a thread go back") {
+        // the thread caches records and frees some of them
+        for (std::size_t i = 0; i < random_data.size() / 2; ++i) {
+            REQUIRE(lockfree_hashtable_insert(&table, random_data[i].first.data(), random_data[i].second.data()));
+        }
+        for (std::size_t i = 0; i < random_data.size() / 2; i += 2) {
+            REQUIRE(lockfree_hashtable_erase(&table, random_data[i].first.data()));
+        }
+        lockfree_hashtable_release_magazine(&table);
+
+        // other threads fill the table after that but the last records
+        std::atomic_bool failed = false;
+        auto insert = [&] (std::size_t first, std::size_t step) {
+            for (std::size_t i = first; i < random_data.size() - reserved; i += step) {
+                if (i < random_data.size() / 2 && i % 2 == 1) {
+                    continue;
+                }
+                auto& [key, val] = random_data[i];
+                if (!lockfree_hashtable_insert(&table, key.data(), val.data())) {
+                    failed = true;
+                }
+            }
+        };
+        std::vector<std::thread> threads;
+        for (std::size_t i = 0; i < 4; ++i) {
+            threads.emplace_back(insert, i, 4);
+        }
+        for (auto& th: threads) {
+            th.join();
+        }
+        REQUIRE(!failed);
+
+        for (std::size_t i = random_data.size() - reserved; i < random_data.size(); ++i) {
+            REQUIRE(lockfree_hashtable_insert(&table, random_data[i].first.data(), random_data[i].second.data()));
+        }
+        for (auto& [key, val]: random_data) {
+            REQUIRE(lockfree_hashtable_find(&table, key.data(), find.data()));
+            REQUIRE(find == val);
+        }
+    }
+
+    SECTION("records cached by exited threads are used") {
+        std::atomic_bool failed = false;
+        // every thread inserts and erases its own keys a few times, the last round keeps a third of them
+        const std::size_t rounds = 10;
+        auto insert_and_erase = [&] (std::size_t first, std::size_t step) {
+            for (std::size_t round = 0; round < rounds; ++round) {
+                for (std::size_t i = first; i < random_data.size() - reserved; i += step) {
+                    auto& [key, val] = random_data[i];
+                    if (!lockfree_hashtable_insert(&table, key.data(), val.data())) {
+                        failed = true;
+                    }
+                }
+                for (std::size_t i = first; i < random_data.size() - reserved; i += step) {
+                    if ((round + 1 < rounds || i % 3 != 0) && !lockfree_hashtable_erase(&table, random_data[i].first.data())) {
+                        failed = true;
+                    }
+                }
+            }
+        };
+        std::vector<std::thread> threads;
+        for (std::size_t i = 0; i < 4; ++i) {
+            threads.emplace_back(insert_and_erase, i, 4);
+        }
+        for (auto& th: threads) {
+            th.join();
+        }
+        REQUIRE(!failed);
+
+        for (std::size_t i = 0; i < random_data.size(); ++i) {
+            auto& [key, val] = random_data[i];
+            REQUIRE(lockfree_hashtable_find(&table, key.data(), nullptr) == (i % 3 == 0 && i < random_data.size() - reserved));
+        }
+        // all records are free again but the kept ones
+        for (std::size_t i = 0; i < random_data.size(); ++i) {
+            if (i % 3 != 0 || i >= random_data.size() - reserved) {
+                REQUIRE(lockfree_hashtable_insert(&table, random_data[i].first.data(), random_data[i].second.data()));
+            }
+        }
+        const auto key = random_string("key_1", key_size, generator);
+        REQUIRE(!lockfree_hashtable_insert(&table, key.data(), random_data[0].second.data()));
+    }
+
+    SECTION("table initialized again in the same memory") {
+        for (std::size_t i = 0; i < random_data.size() / 2; ++i) {
+            REQUIRE(lockfree_hashtable_insert(&table, random_data[i].first.data(), random_data[i].second.data()));
+        }
+        lockfree_hashtable_init(&table, &config, memory.get());
+        fill();
+    }
+}
+
+TEST_CASE("magazines of freed tables", "[magazines][insert][erase]") {
+    const std::size_t key_size = 64;
+    const std::size_t val_size = 16;
+    const std::size_t table_size = 1'000;
+    const lockfree_hashtable_config_t config = {
+        table_size,
+        key_size,
+        val_size,
+        LOCKFREE_HASHTABLE_MAGAZINES
+    };
+
+    std::mt19937 generator{std::random_device{}()};
+    const auto random_data = generate_random_data(table_size, key_size, val_size, generator);
+
+    auto fill = [&] (lockfree_hashtable_t* table) {
+        for (auto& [key, val]: random_data) {
+            REQUIRE(lockfree_hashtable_insert(table, key.data(), val.data()));
+        }
+        // the magazine of the thread caches freed records
+        for (std::size_t i = 0; i < random_data.size(); i += 5) {
+            REQUIRE(lockfree_hashtable_erase(table, random_data[i].first.data()));
+        }
+    };
+
+    // the table memory is freed without lockfree_hashtable_release_magazine, then the thread uses another table
+    for (std::size_t round = 0; round < 3; ++round) {
+        std::unique_ptr<std::uint8_t[]> memory(new std::uint8_t[lockfree_hashtable_calc_mem_size(&config)]);
+        lockfree_hashtable_t table;
+        lockfree_hashtable_init(&table, &config, memory.get());
+        fill(&table);
+    }
+
+    // two tables used in turns keep all their records
+    std::unique_ptr<std::uint8_t[]> memory1(new std::uint8_t[lockfree_hashtable_calc_mem_size(&config)]);
+    std::unique_ptr<std::uint8_t[]> memory2(new std::uint8_t[lockfree_hashtable_calc_mem_size(&config)]);
+    lockfree_hashtable_t table1;
+    lockfree_hashtable_t table2;
+    lockfree_hashtable_init(&table1, &config, memory1.get());
+    lockfree_hashtable_init(&table2, &config, memory2.get());
+    for (auto& [key, val]: random_data) {
+        REQUIRE(lockfree_hashtable_insert(&table1, key.data(), val.data()));
+        REQUIRE(lockfree_hashtable_insert(&table2, key.data(), val.data()));
+    }
+    for (auto& [key, val]: random_data) {
+        REQUIRE(lockfree_hashtable_erase(&table1, key.data()));
+        REQUIRE(lockfree_hashtable_erase(&table2, key.data()));
+    }
+    fill(&table1);
+    fill(&table2);
+}
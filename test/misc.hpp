@@ -4,6 +4,7 @@
 #include <string_view>
 #include <random>
 #include <span>
+#include <algorithm>
 
 template<class Generator>
 std::string random_string(std::string_view prefix, std::string::size_type length, Generator& generator)
@@ -45,15 +46,17 @@ auto generate_random_data(std::size_t size, std::size_t key_size, std::size_t va
 }
 
 template<class Generator>
-void random_string(std::uint32_t prefix, std::span<std::uint8_t> array, Generator& generator)
+void random_string(std::uint64_t prefix, std::span<std::uint8_t> array, Generator& generator)
 {
     std::uniform_int_distribution<std::string::size_type> pick(0, std::numeric_limits<std::uint8_t>::max());
 
-    std::memcpy(array.data(), &prefix, sizeof(prefix));
-    const auto length = array.size() - sizeof(prefix);
+    // 64 bit prefix keeps keys unique in tables beyond 2^32 records
+    const auto prefix_size = std::min(sizeof(prefix), array.size());
+    std::memcpy(array.data(), &prefix, prefix_size);
+    const auto length = array.size() - prefix_size;
 
     for (std::size_t i = 0; i < length; ++i) {
-        array[i + sizeof(prefix)] = pick(generator);
+        array[i + prefix_size] = pick(generator);
     }
 }
 
@@ -86,3 +89,26 @@ auto generate_random_key_val_data(std::uint8_t* memory, std::size_t prefix, std:
         random_string(i + prefix, std::span(val, val_size), generator);
     }
 }
+
+// value of a "--name=N" command line option, "fallback" if there is no such option
+inline std::size_t size_arg(int argc, char** argv, std::string_view name, std::size_t fallback)
+{
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view arg(argv[i]);
+        if (arg.size() > name.size() + 1 && arg.substr(0, name.size()) == name && arg[name.size()] == '=') {
+            return std::stoull(std::string(arg.substr(name.size() + 1)));
+        }
+    }
+    return fallback;
+}
+
+// true if there is a "--name" command line option
+inline bool flag_arg(int argc, char** argv, std::string_view name)
+{
+    for (int i = 1; i < argc; ++i) {
+        if (std::string_view(argv[i]) == name) {
+            return true;
+        }
+    }
+    return false;
+}
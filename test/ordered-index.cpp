@@ -0,0 +1,216 @@
+#include <memory>
+#include <vector>
+#include <map>
+#include <future>
+#include <atomic>
+#include <algorithm>
+#include <stdexcept>
+
+#include <catch2/catch_all.hpp>
+#include <lockfree-hashtable.h>
+#include "misc.hpp"
+
+using pairs_t = std::vector<std::pair<std::string, std::string>>;
+
+static pairs_t scan_range(lockfree_hashtable_t* table, const char* first, const char* last, std::size_t limit = SIZE_MAX)
+{
+    struct context_t {
+        const lockfree_hashtable_config_t* config;
+        pairs_t pairs;
+        std::size_t limit;
+    } context{table->config, {}, limit};
+
+    auto visit = [] (const void* key, const void* val, void* arg) {
+        auto* context = static_cast<context_t*>(arg);
+        context->pairs.emplace_back(
+            std::string(static_cast<const char*>(key), context->config->key_size),
+            std::string(static_cast<const char*>(val), context->config->val_size)
+        );
+        return context->pairs.size() < context->limit;
+    };
+    // called from threads too, so no REQUIRE here
+    if (lockfree_hashtable_range(table, first, last, visit, &context) != context.pairs.size()) {
+        throw std::logic_error("wrong number of visited pairs");
+    }
+    return context.pairs;
+}
+
+static pairs_t map_range(const std::map<std::string, std::string>& map, const std::string& first, const std::string& last)
+{
+    return pairs_t(map.lower_bound(first), map.upper_bound(last));
+}
+
+TEST_CASE("ordered index range scans", "[index][insert][erase]") {
+    const std::size_t key_size = GENERATE(8, 64);
+    const std::size_t val_size = 16;
+    const std::size_t table_size = 5'000;
+    const lockfree_hashtable_config_t config = {
+        table_size,
+        key_size,
+        val_size,
+        LOCKFREE_HASHTABLE_ORDERED_INDEX
+    };
+
+    std::mt19937 generator{std::random_device{}()};
+    const auto random_data = generate_random_data(table_size - 1, key_size, val_size, generator);
+    std::map<std::string, std::string> map;
+
+    std::unique_ptr<std::uint8_t[]> memory(new std::uint8_t[lockfree_hashtable_calc_mem_size(&config)]);
+
+    lockfree_hashtable_t table;
+    lockfree_hashtable_init(&table, &config, memory.get());
+    REQUIRE(scan_range(&table, nullptr, nullptr).empty());
+
+    SECTION("insert, overwrite and erase") {
+        for (auto& [key, val]: random_data) {
+            REQUIRE(lockfree_hashtable_insert(&table, key.data(), val.data()));
+            map[key] = val;
+        }
+        REQUIRE(scan_range(&table, nullptr, nullptr) == pairs_t(map.begin(), map.end()));
+
+        for (std::size_t i = 0; i < random_data.size(); i += 3) {
+            const auto val = random_string(val_size, generator);
+            REQUIRE(lockfree_hashtable_insert(&table, random_data[i].first.data(), val.data()));
+            map[random_data[i].first] = val;
+        }
+        REQUIRE(scan_range(&table, nullptr, nullptr) == pairs_t(map.begin(), map.end()));
+
+        for (std::size_t i = 1; i < random_data.size(); i += 3) {
+            REQUIRE(lockfree_hashtable_erase(&table, random_data[i].first.data()));
+            map.erase(random_data[i].first);
+        }
+        REQUIRE(scan_range(&table, nullptr, nullptr) == pairs_t(map.begin(), map.end()));
+
+        // bounds are inclusive and don't have to be present in the table
+        const auto& first = std::next(map.begin(), map.size() / 4)->first;
+        const auto& last = std::next(map.begin(), map.size() / 2)->first;
+        REQUIRE(scan_range(&table, first.data(), last.data()) == map_range(map, first, last));
+        auto absent_first = first;
+        absent_first.back() += 1;
+        REQUIRE(scan_range(&table, absent_first.data(), last.data()) == map_range(map, absent_first, last));
+        REQUIRE(scan_range(&table, last.data(), first.data()).empty());
+
+        // all keys with the prefix "12"
+        std::string prefix_first(key_size, '\0');
+        std::string prefix_last(key_size, '\xff');
+        prefix_first.replace(0, 2, "12");
+        prefix_last.replace(0, 2, "12");
+        const auto prefix = scan_range(&table, prefix_first.data(), prefix_last.data());
+        REQUIRE(!prefix.empty());
+        REQUIRE(prefix == map_range(map, prefix_first, prefix_last));
+
+        // the scan stops when "visit" returns false
+        REQUIRE(scan_range(&table, nullptr, nullptr, 10) == pairs_t(map.begin(), std::next(map.begin(), 10)));
+
+        for (auto& [key, val]: map) {
+            REQUIRE(lockfree_hashtable_erase(&table, key.data()));
+        }
+        REQUIRE(scan_range(&table, nullptr, nullptr).empty());
+    }
+
+    SECTION("bulk load") {
+        std::vector<std::uint8_t> data;
+        for (auto& [key, val]: random_data) {
+            data.insert(data.end(), key.begin(), key.end());
+            data.insert(data.end(), val.begin(), val.end());
+            map[key] = val;
+        }
+        REQUIRE(lockfree_hashtable_bulk_load(&table, data.data(), random_data.size(), LOCKFREE_HASHTABLE_BULK_FAIL, 3));
+        REQUIRE(scan_range(&table, nullptr, nullptr) == pairs_t(map.begin(), map.end()));
+    }
+
+    SECTION("concurrent changes and scans") {
+        const std::size_t thread_count = 4;
+        std::atomic_bool done = false;
+
+        for (auto& [key, val]: random_data) {
+            REQUIRE(lockfree_hashtable_insert(&table, key.data(), val.data()));
+        }
+        const std::map<std::string, std::string> stable_map(random_data.begin() + random_data.size() / 2, random_data.end());
+        const pairs_t stable(stable_map.begin(), stable_map.end());
+
+        // every thread erases and inserts again its own keys of the first half
+        auto change = [&] (std::size_t first) {
+            std::mt19937 generator{std::random_device{}()};
+            for (std::size_t round = 0; round < 5; ++round) {
+                for (std::size_t i = first; i < random_data.size() / 2; i += thread_count) {
+                    if (!lockfree_hashtable_erase(&table, random_data[i].first.data())) {
+                        return false;
+                    }
+                }
+                for (std::size_t i = first; i < random_data.size() / 2; i += thread_count) {
+                    const auto val = random_string(val_size, generator);
+                    if (!lockfree_hashtable_insert(&table, random_data[i].first.data(), val.data())) {
+                        return false;
+                    }
+                }
+            }
+            return true;
+        };
+        // keys of a scan go in the strict order and keys of the second half are always visited
+        auto scan = [&] {
+            std::size_t scans = 0;
+            while (!done || scans == 0) {
+                const auto pairs = scan_range(&table, nullptr, nullptr);
+                for (std::size_t i = 1; i < pairs.size(); ++i) {
+                    if (pairs[i - 1].first >= pairs[i].first) {
+                        return false;
+                    }
+                }
+                pairs_t visited_stable;
+                std::copy_if(pairs.begin(), pairs.end(), std::back_inserter(visited_stable), [&] (auto& pair) {
+                    return std::binary_search(stable.begin(), stable.end(), pair);
+                });
+                if (visited_stable != stable) {
+                    return false;
+                }
+                scans += 1;
+            }
+            return true;
+        };
+
+        auto scanner = std::async(std::launch::async, scan);
+        std::vector<std::future<bool>> threads;
+        for (std::size_t i = 0; i < thread_count; ++i) {
+            threads.emplace_back(std::async(std::launch::async, change, i));
+        }
+        std::vector<bool> results;
+        for (auto& th: threads) {
+            results.push_back(th.get());
+        }
+        done = true;
+        REQUIRE(scanner.get());
+        REQUIRE(std::find(results.begin(), results.end(), false) == results.end());
+
+        std::string find;
+        find.resize(val_size, ' ');
+        for (auto& [key, val]: random_data) {
+            REQUIRE(lockfree_hashtable_find(&table, key.data(), find.data()));
+            map[key] = find;
+        }
+        REQUIRE(scan_range(&table, nullptr, nullptr) == pairs_t(map.begin(), map.end()));
+    }
+}
+
+TEST_CASE("table without ordered index", "[index]") {
+    const unsigned flags = GENERATE(0u, LOCKFREE_HASHTABLE_ORDERED_INDEX | LOCKFREE_HASHTABLE_HASHED_KEYS);
+    const lockfree_hashtable_config_t config = {
+        100,
+        64,
+        16,
+        flags
+    };
+
+    std::mt19937 generator{std::random_device{}()};
+    const auto random_data = generate_random_data(10, config.key_size, config.val_size, generator);
+
+    std::unique_ptr<std::uint8_t[]> memory(new std::uint8_t[lockfree_hashtable_calc_mem_size(&config)]);
+
+    lockfree_hashtable_t table;
+    lockfree_hashtable_init(&table, &config, memory.get());
+    for (auto& [key, val]: random_data) {
+        REQUIRE(lockfree_hashtable_insert(&table, key.data(), val.data()));
+    }
+    REQUIRE(table.index == nullptr);
+    REQUIRE(scan_range(&table, nullptr, nullptr).empty());
+}
@@ -0,0 +1,155 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <string_view>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// hardware counters of the calling thread, turned on by "--perf" in the command line of a benchmark
+struct perf_counter_values
+{
+    static constexpr std::size_t size = 5;
+    static constexpr std::array<std::string_view, size> names = {
+        "cycles", "instructions", "LLC misses", "dTLB misses", "branch misses"
+    };
+
+    std::array<double, size> values{};
+    // a counter can't be opened, e.g. it isn't permitted or supported
+    std::array<bool, size> available{};
+
+    perf_counter_values& operator+=(const perf_counter_values& other)
+    {
+        for (std::size_t i = 0; i < size; ++i) {
+            values[i] += other.values[i];
+            available[i] = available[i] || other.available[i];
+        }
+        return *this;
+    }
+};
+
+class perf_counters
+{
+public:
+    static inline bool enabled = false;
+
+    static void parse_args(int argc, char** argv)
+    {
+        for (int i = 1; i < argc; ++i) {
+            if (std::string_view(argv[i]) == "--perf") {
+                enabled = true;
+            }
+        }
+    }
+
+    perf_counters()
+    {
+        fds.fill(-1);
+#if defined(__linux__)
+        if (!enabled) {
+            return;
+        }
+        const std::array<std::pair<std::uint32_t, std::uint64_t>, perf_counter_values::size> events = {{
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+            {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+            {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+        }};
+        for (std::size_t i = 0; i < events.size(); ++i) {
+            perf_event_attr attr;
+            std::memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = events[i].first;
+            attr.config = events[i].second;
+            attr.disabled = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            // counters are multiplexed if there are not enough of them, so values are scaled by running time
+            attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            fds[i] = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+            result.available[i] = fds[i] >= 0;
+        }
+#endif
+    }
+
+    perf_counters(const perf_counters&) = delete;
+    perf_counters& operator=(const perf_counters&) = delete;
+
+    ~perf_counters()
+    {
+#if defined(__linux__)
+        for (int fd: fds) {
+            if (fd >= 0) {
+                close(fd);
+            }
+        }
+#endif
+    }
+
+    void start()
+    {
+#if defined(__linux__)
+        for (int fd: fds) {
+            if (fd >= 0) {
+                ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+            }
+        }
+#endif
+    }
+
+    void stop()
+    {
+#if defined(__linux__)
+        for (int fd: fds) {
+            if (fd >= 0) {
+                ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+            }
+        }
+#endif
+    }
+
+    // values counted between all start() and stop() calls
+    perf_counter_values values() const
+    {
+        perf_counter_values values = result;
+#if defined(__linux__)
+        for (std::size_t i = 0; i < fds.size(); ++i) {
+            std::uint64_t data[3] = {};
+            if (fds[i] >= 0 && read(fds[i], data, sizeof(data)) == sizeof(data) && data[2] > 0) {
+                values.values[i] = data[0] * (double(data[1]) / data[2]);
+            }
+        }
+#endif
+        return values;
+    }
+
+private:
+    std::array<int, perf_counter_values::size> fds;
+    perf_counter_values result;
+};
+
+// print counters divided by the number of operations
+inline void print_perf_counters(std::ostream& out, std::string_view name, const perf_counter_values& values, double operations)
+{
+    if (!perf_counters::enabled) {
+        return;
+    }
+    out << name << " per operation:";
+    for (std::size_t i = 0; i < values.size; ++i) {
+        out << " " << values.names[i] << ": ";
+        if (values.available[i]) {
+            out << values.values[i] / operations;
+        } else {
+            out << "n/a";
+        }
+        out << (i + 1 < values.size ? "," : "");
+    }
+    out << std::endl;
+}
@@ -0,0 +1,160 @@
+#include <memory>
+#include <vector>
+#include <cstdio>
+
+#if defined(__unix__)
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include <catch2/catch_all.hpp>
+#include <lockfree-hashtable.h>
+#include "misc.hpp"
+
+TEST_CASE("attach table", "[attach][insert][find]") {
+    const std::size_t key_size = 64;
+    const std::size_t val_size = 128;
+    const std::size_t table_size = 1000;
+    const auto config = std::make_unique<lockfree_hashtable_config_t>(lockfree_hashtable_config_t{
+        table_size,
+        key_size,
+        val_size
+    });
+
+    std::mt19937 generator{std::random_device{}()};
+    const auto random_data = generate_random_data(table_size / 2, key_size, val_size, generator);
+    std::string find;
+    find.resize(val_size, ' ');
+
+    const auto mem_size = lockfree_hashtable_calc_mem_size(config.get());
+    std::unique_ptr<std::uint8_t[]> memory(new std::uint8_t[mem_size]);
+
+    lockfree_hashtable_t other;
+    std::memset(memory.get(), 0, mem_size);
+    REQUIRE(!lockfree_hashtable_attach(&other, memory.get()));
+
+    lockfree_hashtable_t table;
+    lockfree_hashtable_init(&table, config.get(), memory.get());
+    for (auto& [key, val]: random_data) {
+        REQUIRE(lockfree_hashtable_insert(&table, key.data(), val.data()));
+    }
+
+    SECTION("attach the same memory") {
+        REQUIRE(lockfree_hashtable_attach(&other, memory.get()));
+        REQUIRE(other.config->table_size == table_size);
+        for (auto& [key, val]: random_data) {
+            REQUIRE(lockfree_hashtable_find(&other, key.data(), find.data()));
+            REQUIRE(find == val);
+        }
+        REQUIRE(lockfree_hashtable_erase(&other, random_data[0].first.data()));
+        REQUIRE(!lockfree_hashtable_find(&table, random_data[0].first.data(), nullptr));
+    }
+
+    SECTION("attach moved memory without the config") {
+        std::unique_ptr<std::uint8_t[]> copy(new std::uint8_t[mem_size]);
+        std::memcpy(copy.get(), memory.get(), mem_size);
+        std::memset(memory.get(), 0, mem_size);
+        std::memset(config.get(), 0, sizeof(lockfree_hashtable_config_t));
+
+        REQUIRE(lockfree_hashtable_attach(&other, copy.get()));
+        for (auto& [key, val]: random_data) {
+            REQUIRE(lockfree_hashtable_find(&other, key.data(), find.data()));
+            REQUIRE(find == val);
+        }
+    }
+}
+
+#if defined(__unix__)
+// unmaps the memory when the test ends or fails
+struct mapping_guard {
+    void* memory;
+    std::size_t size;
+    ~mapping_guard() {
+        if (memory != MAP_FAILED) {
+            munmap(memory, size);
+        }
+    }
+};
+
+TEST_CASE("share table between processes", "[attach][insert][find]") {
+    const std::size_t key_size = 64;
+    const std::size_t val_size = 128;
+    const std::size_t table_size = 10'000;
+    const std::size_t process_count = 4;
+    const lockfree_hashtable_config_t config = {
+        table_size,
+        key_size,
+        val_size
+    };
+
+    std::mt19937 generator{std::random_device{}()};
+    const auto random_data = generate_random_data(table_size / 2, key_size, val_size, generator);
+    std::string find;
+    find.resize(val_size, ' ');
+
+    // the table lives in a file, so every mapping of it may get another address
+    const auto mem_size = lockfree_hashtable_calc_mem_size(&config);
+    const std::unique_ptr<std::FILE, decltype(&std::fclose)> file(std::tmpfile(), &std::fclose);
+    REQUIRE(file);
+    const int fd = fileno(file.get());
+    REQUIRE(ftruncate(fd, static_cast<off_t>(mem_size)) == 0);
+    const mapping_guard mapping{mmap(nullptr, mem_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0), mem_size};
+    REQUIRE(mapping.memory != MAP_FAILED);
+
+    lockfree_hashtable_t table;
+    lockfree_hashtable_init(&table, &config, mapping.memory);
+
+    // every process inserts its own part of the data through its own mapping of the file,
+    // the mapping inherited from the parent is dropped, so the table is used only at the new address
+    std::vector<pid_t> children;
+    for (std::size_t i = 0; i < process_count; ++i) {
+        const pid_t pid = fork();
+        if (pid == 0) {
+            int status = 0;
+            void* memory = mmap(nullptr, mem_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            if (memory == MAP_FAILED || memory == mapping.memory) {
+                _exit(3);
+            }
+            munmap(mapping.memory, mem_size);
+            lockfree_hashtable_t table;
+            if (!lockfree_hashtable_attach(&table, memory)) {
+                _exit(1);
+            }
+            for (std::size_t j = i; j < random_data.size(); j += process_count) {
+                auto& [key, val] = random_data[j];
+                if (!lockfree_hashtable_insert(&table, key.data(), val.data())) {
+                    status = 2;
+                }
+            }
+            _exit(status);
+        }
+        REQUIRE(pid > 0);
+        children.push_back(pid);
+    }
+    for (auto pid: children) {
+        int status = -1;
+        REQUIRE(waitpid(pid, &status, 0) == pid);
+        REQUIRE(WIFEXITED(status));
+        REQUIRE(WEXITSTATUS(status) == 0);
+    }
+
+    for (auto& [key, val]: random_data) {
+        REQUIRE(lockfree_hashtable_find(&table, key.data(), find.data()));
+        REQUIRE(find == val);
+    }
+
+    // a second mapping in the same process sees the same table and its changes
+    const mapping_guard second{mmap(nullptr, mem_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0), mem_size};
+    REQUIRE(second.memory != MAP_FAILED);
+    REQUIRE(second.memory != mapping.memory);
+    lockfree_hashtable_t other;
+    REQUIRE(lockfree_hashtable_attach(&other, second.memory));
+    for (auto& [key, val]: random_data) {
+        REQUIRE(lockfree_hashtable_find(&other, key.data(), find.data()));
+        REQUIRE(find == val);
+    }
+    REQUIRE(lockfree_hashtable_erase(&other, random_data[0].first.data()));
+    REQUIRE(!lockfree_hashtable_find(&table, random_data[0].first.data(), nullptr));
+}
+#endif
@@ -0,0 +1,135 @@
+#include <memory>
+#include <vector>
+#include <future>
+#include <algorithm>
+
+#include <catch2/catch_all.hpp>
+#include <lockfree-hashtable.h>
+#include "misc.hpp"
+
+TEST_CASE("slots of pairs", "[slot][insert][find][erase]") {
+    const std::size_t key_size = 64;
+    const std::size_t val_size = 16;
+    const std::size_t table_size = 1'000;
+    const unsigned flags = GENERATE(0u, LOCKFREE_HASHTABLE_HASHED_KEYS, LOCKFREE_HASHTABLE_ORDERED_INDEX | LOCKFREE_HASHTABLE_CLEARABLE);
+    const lockfree_hashtable_config_t config = {
+        table_size,
+        key_size,
+        val_size,
+        flags
+    };
+
+    std::mt19937 generator{std::random_device{}()};
+    const auto random_data = generate_random_data(table_size / 2, key_size, val_size, generator);
+    std::string find;
+    find.resize(val_size, ' ');
+
+    std::unique_ptr<std::uint8_t[]> memory(new std::uint8_t[lockfree_hashtable_calc_mem_size(&config)]);
+
+    lockfree_hashtable_t table;
+    lockfree_hashtable_init(&table, &config, memory.get());
+
+    std::vector<lockfree_hashtable_slot_t> slots(random_data.size());
+    for (std::size_t i = 0; i < random_data.size(); ++i) {
+        auto& [key, val] = random_data[i];
+        REQUIRE(lockfree_hashtable_insert_slot(&table, key.data(), val.data(), &slots[i]));
+        REQUIRE(slots[i].index < table_size);
+    }
+
+    SECTION("find, update and erase at slots") {
+        for (std::size_t i = 0; i < random_data.size(); ++i) {
+            auto& [key, val] = random_data[i];
+            lockfree_hashtable_slot_t slot;
+            REQUIRE(lockfree_hashtable_find_slot(&table, key.data(), find.data(), &slot));
+            REQUIRE(find == val);
+            REQUIRE(slot.index == slots[i].index);
+            REQUIRE(slot.entry == slots[i].entry);
+        }
+        for (std::size_t i = 0; i < random_data.size(); ++i) {
+            const auto val = random_string(val_size, generator);
+            const auto old = slots[i];
+            REQUIRE(lockfree_hashtable_update_at(&table, &slots[i], random_data[i].first.data(), val.data()));
+            REQUIRE(slots[i].index == old.index);
+            REQUIRE(slots[i].entry != old.entry);
+            REQUIRE(lockfree_hashtable_find(&table, random_data[i].first.data(), find.data()));
+            REQUIRE(find == val);
+        }
+        for (std::size_t i = 0; i < random_data.size(); i += 2) {
+            REQUIRE(lockfree_hashtable_erase_at(&table, &slots[i], random_data[i].first.data()));
+            REQUIRE(!lockfree_hashtable_find(&table, random_data[i].first.data(), nullptr));
+            REQUIRE(!lockfree_hashtable_erase_at(&table, &slots[i], random_data[i].first.data()));
+        }
+        for (std::size_t i = 1; i < random_data.size(); i += 2) {
+            REQUIRE(lockfree_hashtable_find(&table, random_data[i].first.data(), nullptr));
+        }
+    }
+
+    SECTION("changed slots fall back to the probe") {
+        auto& [key, val] = random_data[0];
+        auto& [other_key, other_val] = random_data[1];
+        const auto old = slots[0];
+
+        // the slot was changed by an overwrite
+        REQUIRE(lockfree_hashtable_insert(&table, key.data(), other_val.data()));
+        lockfree_hashtable_slot_t slot = old;
+        REQUIRE(lockfree_hashtable_update_at(&table, &slot, key.data(), val.data()));
+        REQUIRE(slot.entry != old.entry);
+        REQUIRE(lockfree_hashtable_find(&table, key.data(), find.data()));
+        REQUIRE(find == val);
+        lockfree_hashtable_slot_t found;
+        REQUIRE(lockfree_hashtable_find_slot(&table, key.data(), nullptr, &found));
+        REQUIRE(found.index == slot.index);
+        REQUIRE(found.entry == slot.entry);
+
+        REQUIRE(lockfree_hashtable_erase_at(&table, &old, key.data()));
+        REQUIRE(!lockfree_hashtable_find(&table, key.data(), nullptr));
+
+        // a slot of another key doesn't change that key
+        REQUIRE(lockfree_hashtable_update_at(&table, &slots[1], key.data(), val.data()));
+        REQUIRE(lockfree_hashtable_find(&table, key.data(), find.data()));
+        REQUIRE(find == val);
+        REQUIRE(lockfree_hashtable_find(&table, other_key.data(), find.data()));
+        REQUIRE(find == other_val);
+        REQUIRE(lockfree_hashtable_erase_at(&table, &slots[1], key.data()));
+        REQUIRE(lockfree_hashtable_find(&table, other_key.data(), nullptr));
+    }
+
+    SECTION("concurrent updates at slots") {
+        const std::size_t key_count = 16;
+        // every thread finds the slot of a shared key and overwrites it with its own value
+        auto update = [&] (std::size_t id, std::size_t count) {
+            for (std::size_t i = 0; i < count; ++i) {
+                auto& [key, val] = random_data[i % key_count];
+                lockfree_hashtable_slot_t slot;
+                if (!lockfree_hashtable_find_slot(&table, key.data(), nullptr, &slot)) {
+                    return false;
+                }
+                if (!lockfree_hashtable_update_at(&table, &slot, key.data(), random_data[key_count + id].second.data())) {
+                    return false;
+                }
+            }
+            return true;
+        };
+        std::vector<std::future<bool>> threads;
+        for (std::size_t i = 0; i < 4; ++i) {
+            threads.emplace_back(std::async(std::launch::async, update, i, 10'000));
+        }
+        std::vector<bool> results;
+        for (auto& th: threads) {
+            results.push_back(th.get());
+        }
+        REQUIRE(std::find(results.begin(), results.end(), false) == results.end());
+        for (std::size_t i = 0; i < key_count; ++i) {
+            REQUIRE(lockfree_hashtable_find(&table, random_data[i].first.data(), find.data()));
+            bool known = false;
+            for (std::size_t id = 0; id < 4; ++id) {
+                known = known || find == random_data[key_count + id].second;
+            }
+            REQUIRE(known);
+        }
+        for (std::size_t i = key_count; i < random_data.size(); ++i) {
+            REQUIRE(lockfree_hashtable_find(&table, random_data[i].first.data(), find.data()));
+            REQUIRE(find == random_data[i].second);
+        }
+    }
+}
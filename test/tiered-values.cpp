@@ -0,0 +1,281 @@
+#include <memory>
+#include <vector>
+#include <future>
+#include <cstdio>
+#include <map>
+#include <unistd.h>
+
+#include <catch2/catch_all.hpp>
+#include <lockfree-hashtable.h>
+#include <lockfree-hashtable-values.h>
+#include "misc.hpp"
+
+using file_t = std::unique_ptr<std::FILE, decltype(&std::fclose)>;
+
+static file_t temporary_file()
+{
+    return file_t(std::tmpfile(), &std::fclose);
+}
+
+TEST_CASE("tiered values", "[tiered][insert][find][erase]") {
+    const std::size_t key_size = 64;
+    const std::size_t val_size = 128;
+    const std::size_t table_size = 2'000;
+    const std::size_t cache_size = GENERATE(0, 64);
+    const unsigned flags = GENERATE(
+        LOCKFREE_HASHTABLE_TIERED_VALUES,
+        LOCKFREE_HASHTABLE_TIERED_VALUES | LOCKFREE_HASHTABLE_HASHED_KEYS,
+        LOCKFREE_HASHTABLE_TIERED_VALUES | LOCKFREE_HASHTABLE_ORDERED_INDEX
+    );
+    lockfree_hashtable_config_t config = {
+        table_size,
+        key_size,
+        val_size,
+        flags
+    };
+    config.value_cache_size = cache_size;
+    lockfree_hashtable_config_t memory_config = config;
+    memory_config.flags &= ~LOCKFREE_HASHTABLE_TIERED_VALUES;
+    // records keep 8 byte offsets instead of values
+    REQUIRE(lockfree_hashtable_calc_mem_size(&config) < lockfree_hashtable_calc_mem_size(&memory_config) - table_size * val_size / 2);
+
+    std::mt19937 generator{std::random_device{}()};
+    const auto random_data = generate_random_data(table_size / 2, key_size, val_size, generator);
+    std::string find;
+    find.resize(val_size, ' ');
+
+    std::unique_ptr<std::uint8_t[]> memory(new std::uint8_t[lockfree_hashtable_calc_mem_size(&config)]);
+    const auto file = temporary_file();
+    REQUIRE(file);
+
+    lockfree_hashtable_t table;
+    lockfree_hashtable_init(&table, &config, memory.get());
+    // nowhere to put values
+    REQUIRE(!lockfree_hashtable_insert(&table, random_data[0].first.data(), random_data[0].second.data()));
+    lockfree_hashtable_set_values_file(&table, fileno(file.get()));
+
+    // finds all keys by one batch
+    auto find_all = [&] (const std::vector<std::pair<std::string, std::string>>& pairs) {
+        std::vector<const void*> keys;
+        std::vector<std::string> vals(pairs.size(), std::string(val_size, ' '));
+        std::vector<void*> val_ptrs;
+        std::vector<lockfree_hashtable_find_status_t> statuses(pairs.size());
+        for (std::size_t i = 0; i < pairs.size(); ++i) {
+            keys.push_back(pairs[i].first.data());
+            val_ptrs.push_back(vals[i].data());
+        }
+        const auto count = lockfree_hashtable_find_batch(&table, keys.data(), val_ptrs.data(), statuses.data(), pairs.size());
+        std::vector<std::pair<std::string, std::string>> result;
+        for (std::size_t i = 0; i < pairs.size(); ++i) {
+            if (statuses[i] == LOCKFREE_HASHTABLE_FIND_FOUND) {
+                result.emplace_back(pairs[i].first, vals[i]);
+            }
+        }
+        REQUIRE(count == result.size());
+        return result;
+    };
+
+    SECTION("insert, find and erase") {
+        for (auto& [key, val]: random_data) {
+            REQUIRE(lockfree_hashtable_insert(&table, key.data(), val.data()));
+        }
+        for (auto& [key, val]: random_data) {
+            REQUIRE(lockfree_hashtable_find(&table, key.data(), find.data()));
+            REQUIRE(find == val);
+        }
+        REQUIRE(find_all(random_data) == random_data);
+
+        // new values are appended
+        auto pairs = random_data;
+        for (std::size_t i = 0; i < pairs.size(); i += 3) {
+            pairs[i].second = random_string(val_size, generator);
+            REQUIRE(lockfree_hashtable_insert(&table, pairs[i].first.data(), pairs[i].second.data()));
+        }
+        REQUIRE(find_all(pairs) == pairs);
+
+        std::vector<std::pair<std::string, std::string>> kept;
+        for (std::size_t i = 0; i < pairs.size(); ++i) {
+            if (i % 2 == 0) {
+                REQUIRE(lockfree_hashtable_erase(&table, pairs[i].first.data()));
+            } else {
+                kept.push_back(pairs[i]);
+            }
+        }
+        REQUIRE(find_all(pairs) == kept);
+        for (auto& [key, val]: kept) {
+            REQUIRE(lockfree_hashtable_find(&table, key.data(), find.data()));
+            REQUIRE(find == val);
+        }
+
+        // values are not needed
+        std::vector<const void*> keys{pairs[0].first.data(), pairs[1].first.data()};
+        std::vector<void*> vals{nullptr, nullptr};
+        lockfree_hashtable_find_status_t statuses[2];
+        REQUIRE(lockfree_hashtable_find_batch(&table, keys.data(), vals.data(), statuses, 2) == 1);
+        REQUIRE(statuses[0] == LOCKFREE_HASHTABLE_FIND_MISSING);
+        REQUIRE(statuses[1] == LOCKFREE_HASHTABLE_FIND_FOUND);
+
+        if (table.index) {
+            std::map<std::string, std::string> map(kept.begin(), kept.end());
+            auto visit = [] (const void* key, const void* val, void* context) {
+                auto* map = static_cast<std::map<std::string, std::string>*>(context);
+                auto it = map->find(std::string(static_cast<const char*>(key), 64));
+                if (it == map->end() || it->second != std::string(static_cast<const char*>(val), 128)) {
+                    return false;
+                }
+                map->erase(it);
+                return true;
+            };
+            REQUIRE(lockfree_hashtable_range(&table, nullptr, nullptr, visit, &map) == kept.size());
+            REQUIRE(map.empty());
+        }
+
+        SECTION("freeze") {
+            const auto size = lockfree_hashtable_freeze_calc_mem_size(&table);
+            std::vector<std::uint64_t> snapshot(size / sizeof(std::uint64_t));
+            REQUIRE(lockfree_hashtable_freeze(&table, snapshot.data(), size) == size);
+
+            lockfree_hashtable_frozen_t frozen;
+            REQUIRE(lockfree_hashtable_frozen_open(&frozen, snapshot.data(), size));
+            for (auto& [key, val]: kept) {
+                REQUIRE(lockfree_hashtable_frozen_find(&frozen, key.data(), find.data()));
+                REQUIRE(find == val);
+            }
+        }
+
+        SECTION("erase if") {
+            auto first_half = [] (const void*, const void* val, void* context) {
+                auto* kept = static_cast<std::vector<std::pair<std::string, std::string>>*>(context);
+                const std::string value(static_cast<const char*>(val), 128);
+                for (std::size_t i = 0; i < kept->size() / 2; ++i) {
+                    if ((*kept)[i].second == value) {
+                        return true;
+                    }
+                }
+                return false;
+            };
+            REQUIRE(lockfree_hashtable_erase_if(&table, first_half, &kept, 2) == kept.size() / 2);
+            REQUIRE(find_all(kept) == decltype(kept)(kept.begin() + kept.size() / 2, kept.end()));
+        }
+    }
+
+    SECTION("bulk load") {
+        std::vector<std::uint8_t> data;
+        for (auto& [key, val]: random_data) {
+            data.insert(data.end(), key.begin(), key.end());
+            data.insert(data.end(), val.begin(), val.end());
+        }
+        REQUIRE(lockfree_hashtable_bulk_load(&table, data.data(), random_data.size(), LOCKFREE_HASHTABLE_BULK_FAIL, 3));
+        REQUIRE(find_all(random_data) == random_data);
+    }
+
+    SECTION("concurrent inserts and finds") {
+        auto insert_and_find = [&] (std::size_t first, std::size_t step) {
+            std::string find;
+            find.resize(val_size, ' ');
+            for (std::size_t i = first; i < random_data.size(); i += step) {
+                auto& [key, val] = random_data[i];
+                if (!lockfree_hashtable_insert(&table, key.data(), val.data())) {
+                    return false;
+                }
+                const void* keys[1] = {key.data()};
+                void* vals[1] = {find.data()};
+                lockfree_hashtable_find_status_t statuses[1];
+                if (lockfree_hashtable_find_batch(&table, keys, vals, statuses, 1) != 1 || find != val) {
+                    return false;
+                }
+            }
+            return true;
+        };
+        std::vector<std::future<bool>> threads;
+        for (std::size_t i = 0; i < 4; ++i) {
+            threads.emplace_back(std::async(std::launch::async, insert_and_find, i, 4));
+        }
+        for (auto& th: threads) {
+            REQUIRE(th.get());
+        }
+        REQUIRE(find_all(random_data) == random_data);
+    }
+}
+
+TEST_CASE("values which can't be read", "[tiered][find]") {
+    const std::size_t key_size = 64;
+    const std::size_t val_size = 128;
+    const std::size_t table_size = 1'000;
+    lockfree_hashtable_config_t config = {
+        table_size,
+        key_size,
+        val_size,
+        LOCKFREE_HASHTABLE_TIERED_VALUES
+    };
+    config.value_cache_size = 0;
+
+    std::mt19937 generator{std::random_device{}()};
+    const auto random_data = generate_random_data(table_size / 2, key_size, val_size, generator);
+    std::string find;
+    find.resize(val_size, ' ');
+
+    std::unique_ptr<std::uint8_t[]> memory(new std::uint8_t[lockfree_hashtable_calc_mem_size(&config)]);
+    const auto file = temporary_file();
+    REQUIRE(file);
+
+    lockfree_hashtable_t table;
+    lockfree_hashtable_init(&table, &config, memory.get());
+    lockfree_hashtable_set_values_file(&table, fileno(file.get()));
+    for (auto& [key, val]: random_data) {
+        REQUIRE(lockfree_hashtable_insert(&table, key.data(), val.data()));
+    }
+    const auto missing = random_string("key_1", key_size, generator);
+    REQUIRE(lockfree_hashtable_lookup(&table, random_data[0].first.data(), find.data()) == LOCKFREE_HASHTABLE_FIND_FOUND);
+    REQUIRE(find == random_data[0].second);
+
+    // every read of a value fails after the file is cut
+    REQUIRE(ftruncate(fileno(file.get()), 0) == 0);
+    REQUIRE(lockfree_hashtable_lookup(&table, random_data[0].first.data(), find.data()) == LOCKFREE_HASHTABLE_FIND_ERROR);
+    REQUIRE(lockfree_hashtable_lookup(&table, missing.data(), find.data()) == LOCKFREE_HASHTABLE_FIND_MISSING);
+    REQUIRE(!lockfree_hashtable_find(&table, random_data[0].first.data(), find.data()));
+    // the key is still found if its value is not needed
+    REQUIRE(lockfree_hashtable_lookup(&table, random_data[0].first.data(), nullptr) == LOCKFREE_HASHTABLE_FIND_FOUND);
+
+    std::vector<const void*> keys{missing.data()};
+    std::vector<std::string> vals(random_data.size() + 1, std::string(val_size, ' '));
+    std::vector<void*> val_ptrs{vals[0].data()};
+    for (std::size_t i = 0; i < random_data.size(); ++i) {
+        keys.push_back(random_data[i].first.data());
+        val_ptrs.push_back(vals[i + 1].data());
+    }
+    std::vector<lockfree_hashtable_find_status_t> statuses(keys.size());
+    REQUIRE(lockfree_hashtable_find_batch(&table, keys.data(), val_ptrs.data(), statuses.data(), keys.size()) == 0);
+    REQUIRE(statuses[0] == LOCKFREE_HASHTABLE_FIND_MISSING);
+    for (std::size_t i = 1; i < statuses.size(); ++i) {
+        REQUIRE(statuses[i] == LOCKFREE_HASHTABLE_FIND_ERROR);
+    }
+}
+
+TEST_CASE("batch reads of the value file", "[tiered]") {
+    const std::size_t val_size = 100;
+    const std::size_t count = 300;
+    const auto file = temporary_file();
+    REQUIRE(file);
+    const int fd = fileno(file.get());
+
+    std::mt19937 generator{std::random_device{}()};
+    std::vector<std::string> vals;
+    for (std::size_t i = 0; i < count; ++i) {
+        vals.push_back(random_string(val_size, generator));
+        REQUIRE(lockfree_hashtable_values_write(fd, i * val_size, vals.back().data(), val_size));
+    }
+
+    // more reads than fit into one submission, every value is read in the reverse order and one read goes after the end of the file
+    std::vector<std::string> read_vals(count + 1, std::string(val_size, ' '));
+    std::vector<lockfree_hashtable_value_read_t> reads;
+    for (std::size_t i = 0; i <= count; ++i) {
+        reads.push_back({(count - i) * val_size, read_vals[i].data(), val_size, false});
+    }
+    lockfree_hashtable_values_read_batch(fd, reads.data(), reads.size());
+    REQUIRE(!reads[0].done);
+    for (std::size_t i = 1; i <= count; ++i) {
+        REQUIRE(reads[i].done);
+        REQUIRE(read_vals[i] == vals[count - i]);
+    }
+}
@@ -0,0 +1,160 @@
+#include <memory>
+#include <vector>
+#include <future>
+
+#include <catch2/catch_all.hpp>
+#include <lockfree-hashtable.h>
+#include "misc.hpp"
+
+TEST_CASE("wide index", "[insert][find][erase]") {
+    const std::size_t key_size = 64;
+    const std::size_t val_size = 16;
+    const std::size_t table_size = GENERATE(17, 1000);
+    const unsigned flags = GENERATE(
+        LOCKFREE_HASHTABLE_WIDE_INDEX,
+        LOCKFREE_HASHTABLE_WIDE_INDEX | LOCKFREE_HASHTABLE_HASHED_KEYS,
+        LOCKFREE_HASHTABLE_WIDE_INDEX | LOCKFREE_HASHTABLE_ORDERED_INDEX
+    );
+    const lockfree_hashtable_config_t config = {
+        table_size,
+        key_size,
+        val_size,
+        flags
+    };
+
+    std::mt19937 generator{std::random_device{}()};
+    const auto random_data = generate_random_data(table_size, key_size, val_size, generator);
+    std::string find;
+    find.resize(val_size, ' ');
+
+    std::unique_ptr<std::uint8_t[]> memory(new std::uint8_t[lockfree_hashtable_calc_mem_size(&config)]);
+
+    lockfree_hashtable_t table;
+    lockfree_hashtable_init(&table, &config, memory.get());
+
+    SECTION("insert, find and erase") {
+        for (auto& [key, val]: random_data) {
+            REQUIRE(lockfree_hashtable_insert(&table, key.data(), val.data()));
+        }
+        for (auto& [key, val]: random_data) {
+            REQUIRE(lockfree_hashtable_find(&table, key.data(), find.data()));
+            REQUIRE(find == val);
+        }
+        const auto key = random_string("key_1", key_size, generator);
+        const auto val = random_string("val_1", val_size, generator);
+        REQUIRE(!lockfree_hashtable_insert(&table, key.data(), val.data()));
+
+        for (std::size_t i = 0; i < random_data.size(); i += 2) {
+            REQUIRE(lockfree_hashtable_erase(&table, random_data[i].first.data()));
+        }
+        for (std::size_t i = 0; i < random_data.size(); ++i) {
+            auto& [key, val] = random_data[i];
+            if (i % 2 == 0) {
+                REQUIRE(!lockfree_hashtable_find(&table, key.data(), nullptr));
+            } else {
+                REQUIRE(lockfree_hashtable_find(&table, key.data(), find.data()));
+                REQUIRE(find == val);
+            }
+        }
+
+        SECTION("freeze") {
+            const auto size = lockfree_hashtable_freeze_calc_mem_size(&table);
+            std::vector<std::uint64_t> snapshot(size / sizeof(std::uint64_t));
+            REQUIRE(lockfree_hashtable_freeze(&table, snapshot.data(), size) == size);
+
+            lockfree_hashtable_frozen_t frozen;
+            REQUIRE(lockfree_hashtable_frozen_open(&frozen, snapshot.data(), size));
+            for (std::size_t i = 1; i < random_data.size(); i += 2) {
+                REQUIRE(lockfree_hashtable_frozen_find(&frozen, random_data[i].first.data(), find.data()));
+                REQUIRE(find == random_data[i].second);
+            }
+        }
+    }
+
+    SECTION("bulk load") {
+        std::vector<std::uint8_t> data;
+        for (auto& [key, val]: random_data) {
+            data.insert(data.end(), key.begin(), key.end());
+            data.insert(data.end(), val.begin(), val.end());
+        }
+        REQUIRE(lockfree_hashtable_bulk_load(&table, data.data(), random_data.size(), LOCKFREE_HASHTABLE_BULK_FAIL, 3));
+        for (auto& [key, val]: random_data) {
+            REQUIRE(lockfree_hashtable_find(&table, key.data(), find.data()));
+            REQUIRE(find == val);
+        }
+    }
+
+    SECTION("concurrent inserts and finds") {
+        auto insert_and_find = [&] (std::size_t first, std::size_t step) {
+            for (std::size_t i = first; i < random_data.size(); i += step) {
+                auto& [key, val] = random_data[i];
+                if (!lockfree_hashtable_insert(&table, key.data(), val.data()) || !lockfree_hashtable_find(&table, key.data(), nullptr)) {
+                    return false;
+                }
+            }
+            return true;
+        };
+        std::vector<std::future<bool>> threads;
+        for (std::size_t i = 0; i < 4; ++i) {
+            threads.emplace_back(std::async(std::launch::async, insert_and_find, i, 4));
+        }
+        for (auto& th: threads) {
+            REQUIRE(th.get());
+        }
+    }
+}
+
+TEST_CASE("wide index versions wrap around", "[insert][find]") {
+    const lockfree_hashtable_config_t config = {
+        4,
+        8,
+        8,
+        LOCKFREE_HASHTABLE_WIDE_INDEX
+    };
+    std::mt19937 generator{std::random_device{}()};
+    const auto random_data = generate_random_data(2, config.key_size, config.val_size, generator);
+    std::string find;
+    find.resize(config.val_size, ' ');
+
+    std::unique_ptr<std::uint8_t[]> memory(new std::uint8_t[lockfree_hashtable_calc_mem_size(&config)]);
+
+    lockfree_hashtable_t table;
+    lockfree_hashtable_init(&table, &config, memory.get());
+
+    // a version has 24 bits, after it wraps around the entry must not look free
+    for (std::size_t i = 0; i < (1u << 24) + 10; ++i) {
+        auto& [key, val] = random_data[i % 2];
+        REQUIRE(lockfree_hashtable_insert(&table, key.data(), val.data()));
+    }
+    for (auto& [key, val]: random_data) {
+        REQUIRE(lockfree_hashtable_find(&table, key.data(), find.data()));
+        REQUIRE(find == val);
+    }
+}
+
+TEST_CASE("size of tables beyond 2^32 records", "[calc_mem_size]") {
+    const std::size_t key_size = 64;
+    const std::size_t val_size = 128;
+    const std::size_t table_size = std::size_t(5) << 30;
+
+    const lockfree_hashtable_config_t config = {
+        table_size,
+        key_size,
+        val_size
+    };
+    const lockfree_hashtable_config_t wide_config = {
+        table_size,
+        key_size,
+        val_size,
+        LOCKFREE_HASHTABLE_WIDE_INDEX
+    };
+    const lockfree_hashtable_config_t too_wide_config = {
+        std::size_t(1) << 40,
+        key_size,
+        val_size,
+        LOCKFREE_HASHTABLE_WIDE_INDEX
+    };
+    REQUIRE(lockfree_hashtable_calc_mem_size(&config) == 0);
+    REQUIRE(lockfree_hashtable_calc_mem_size(&wide_config) > table_size * (sizeof(std::uint64_t) + key_size + val_size));
+    REQUIRE(lockfree_hashtable_calc_mem_size(&too_wide_config) == 0);
+}